@@ -0,0 +1,33 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+//  Optional heap-allocation instrumentation. Building with HFT_COUNT_ALLOCATIONS (CMake
+//  option of the same name) replaces global operator new/delete with versions that count
+//  allocations per thread; otherwise nothing is replaced and the count stays 0.
+namespace alloc_counter {
+
+#ifdef HFT_COUNT_ALLOCATIONS
+constexpr bool kEnabled = true;
+#else
+constexpr bool kEnabled = false;
+#endif
+
+// operator new calls made by the calling thread so far
+std::uint64_t thread_allocations();
+
+// While alive, the calling thread's allocations are also added to `shared`, so work spread
+// over helper threads (e.g. decoders) can be counted by the thread that consumes it
+class ScopedShare {
+public:
+    explicit ScopedShare(std::atomic<std::uint64_t>* shared);
+    ~ScopedShare();
+    ScopedShare(const ScopedShare&) = delete;
+    ScopedShare& operator=(const ScopedShare&) = delete;
+
+private:
+    std::atomic<std::uint64_t>* previous_;
+};
+
+} // namespace alloc_counter
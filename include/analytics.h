@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "depth_kernels.h"
+#include "snapshot.h"
+
+struct AnalyticsConfig {
+    std::size_t imbalance_levels = 5;             // levels per side summed for imbalance
+    std::size_t depth_levels = 10;                // points on each cumulative depth curve
+    std::vector<std::uint64_t> sweep_sizes{1, 10, 100}; // order sizes priced against the book
+};
+
+struct SweepCost {
+    std::uint64_t target = 0;
+    VwapFill buy;  // lifting the asks
+    VwapFill sell; // hitting the bids
+};
+
+// Derived numbers for one instrument over the consolidated (all publishers) book
+struct InstrumentAnalytics {
+    std::uint32_t instrument_id = 0;
+    std::uint64_t seq = 0;              // InstrumentSnapshot::seq these values were computed from
+    LevelSnapshot bid;                  // consolidated BBO
+    LevelSnapshot ask;
+    bool two_sided = false;             // spread/mid/microprice/imbalance are only meaningful when set
+    std::int64_t spread = 0;            // raw price units
+    double mid = 0.0;
+    double microprice = 0.0;            // size-weighted mid: (bid * ask_sz + ask * bid_sz) / (bid_sz + ask_sz)
+    double imbalance = 0.0;             // (bid_qty - ask_qty) / (bid_qty + ask_qty) over imbalance_levels
+    DepthColumns bids;                  // consolidated levels, best first (full depth)
+    DepthColumns asks;
+    std::vector<std::uint64_t> bid_depth; // cumulative size over the first depth_levels
+    std::vector<std::uint64_t> ask_depth;
+    std::vector<SweepCost> sweeps;
+};
+
+struct BookAnalytics {
+    std::vector<std::shared_ptr<const InstrumentAnalytics>> instruments;
+    std::size_t imbalance_levels = 0;
+    std::uint64_t last_ts_recv = 0;
+    std::string last_ts_recv_iso;
+    std::uint64_t mbo_count = 0;
+};
+
+//  Keeps analytics in step with published snapshots. Only instruments whose sequence
+//  changed since the previous update are recomputed; the rest are shared unchanged.
+//  Not thread-safe: one caller (the publisher) drives update().
+class AnalyticsTracker {
+public:
+    explicit AnalyticsTracker(AnalyticsConfig config = {}) : config_(std::move(config)) {}
+    void set_config(AnalyticsConfig config) { config_ = std::move(config); cache_.clear(); }
+
+    std::shared_ptr<const BookAnalytics> update(const BookSnapshot& snap);
+    std::uint64_t recomputed() const { return recomputed_; }
+
+private:
+    AnalyticsConfig config_;
+    std::unordered_map<std::uint32_t, std::shared_ptr<const InstrumentAnalytics>> cache_;
+    std::uint64_t recomputed_ = 0;
+};
+
+// Merges publisher ladders into one price-aggregated ladder per side
+void consolidate_depth(const InstrumentSnapshot& inst, DepthColumns& bids, DepthColumns& asks);
+InstrumentAnalytics compute_instrument_analytics(const InstrumentSnapshot& inst, const AnalyticsConfig& config);
+
+// Prices are rendered in decimal (raw / 1e9); undefined values are null
+std::string analytics_to_json(const BookAnalytics& analytics);
+
+// Parses "1,10,100"; malformed entries are skipped
+std::vector<std::uint64_t> parse_sweep_sizes(const std::string& csv);
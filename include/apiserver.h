@@ -2,9 +2,15 @@
 
 #include <string>
 #include <atomic>
+#include <chrono>
 #include <memory>
+#include <mutex>
 #include "engine.h"
 #include "metrics.h"
+#include "http_server.h"
+#include "response_cache.h"
+
+namespace httplib { class Server; }
 
 //  HTTP/WebSocket server exposing order book and metrics
 class ApiServer {
@@ -24,9 +30,40 @@ private:
     std::atomic<int> peak_connected_clients_{0};
     std::atomic<uint64_t> total_connections_{0};
     std::atomic<uint64_t> total_events_streamed_{0};
+    std::atomic<uint64_t> evicted_clients_{0};
+    std::atomic<uint64_t> dropped_stream_events_{0};
     std::atomic<bool> running_{false};
+    // Minimum spacing between SSE events per client; bursts of book versions
+    // inside the window collapse into one event. Override via STREAM_COALESCE_MS.
+    std::chrono::milliseconds stream_coalesce_{0};
+    uint64_t p99_threshold_ns_ = 10000000; // 10 ms default; LATENCY_P99_THRESHOLD_NS
+    // Versioned bodies for polling clients (ETag / If-None-Match, pre-gzipped variants)
+    ResponseCache orderbook_cache_{"ob", kJsonContentType};
+    ResponseCache orderbook_bin_cache_{"obb", kBinaryContentType};
+    ResponseCache orderbook_col_cache_{"obc", kColumnarContentType};
+    ResponseCache metrics_cache_{"m", kJsonContentType};
+    ResponseCache analytics_cache_{"an", kJsonContentType};
+    EpollServerOptions epoll_options_{};
     std::unique_ptr<httplib::Server> server_; 
+    std::unique_ptr<EpollHttpServer> epoll_server_;
+    // Guards backend creation against stop(): a stop() that runs before start() gets here
+    // (e.g. an early exit in main) is recorded and start() then returns without serving
+    std::mutex server_mutex_;
+    bool stop_requested_ = false;
+    std::atomic<bool> httplib_bound_{false}; // httplib socket bound; listen_after_bind has not returned
+
+    // Backends: epoll event loop (default) or cpp-httplib thread pool (API_SERVER=httplib)
+    void start_epoll();
+    void start_httplib();
+    // Waits on book versions and fans one shared SSE payload per channel (book, analytics) out to epoll streams
+    void stream_publisher_loop();
+    void note_stream_open();
+
     // Handlers
-    std::string handle_orderbook();
     std::string handle_metrics();
+    // Null until the engine publishes; non-JSON encodings are built lazily per version
+    std::shared_ptr<const CachedResponse> cached_orderbook(SnapshotFormat format = SnapshotFormat::Json);
+    std::shared_ptr<const CachedResponse> cached_metrics();
+    std::shared_ptr<const CachedResponse> cached_analytics();
+    uint64_t metrics_epoch() const;
 };
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <unordered_map>
+#include <vector>
+#include "snapshot.h"
+#include "mbo_source.h" // defines HFT_HAS_DATABENTO when the Databento headers are available
+
+//  instrument_id -> dense slot index. Open addressing with linear probing over a flat
+//  power-of-two table (load <= 1/2), so a lookup is a multiply, a shift and usually one probe.
+//  Slots are assigned in first-seen order and never removed.
+class DenseIdIndex {
+public:
+    static constexpr std::uint32_t kNone = std::numeric_limits<std::uint32_t>::max();
+
+    explicit DenseIdIndex(std::size_t expected = 64);
+    std::uint32_t find(std::uint32_t id) const;
+    // Index of id, assigning size() when it is new
+    std::uint32_t insert(std::uint32_t id);
+    std::size_t size() const { return size_; }
+
+private:
+    struct Entry {
+        std::uint32_t id;
+        std::uint32_t index = kNone; // kNone marks an empty entry
+    };
+    std::size_t bucket(std::uint32_t id) const { return (id * 0x9E3779B1u) >> shift_; }
+    void grow();
+
+    std::vector<Entry> table_;
+    std::uint32_t shift_ = 0;
+    std::size_t size_ = 0;
+};
+
+#ifdef HFT_HAS_DATABENTO
+
+// What applying one record did to a publisher book
+enum class MboApplyResult { Applied, OrphanCancel, OrphanModify, UnknownAction };
+
+//  Market-by-order book of one publisher for one instrument. Levels keep their resting
+//  orders in queue priority; size/count totals are maintained on every mutation so
+//  snapshots and samples read them in O(1). Level nodes, order vectors and id-index nodes
+//  all come from the memory resource given at construction (the manager's pool), so
+//  order churn recycles pooled blocks instead of reaching the heap.
+class MboBook {
+public:
+    struct Level {
+        using allocator_type = std::pmr::polymorphic_allocator<databento::MboMsg>;
+        std::pmr::vector<databento::MboMsg> orders;
+        std::uint32_t size = 0;
+        std::uint32_t count = 0; // orders excluding top-of-book records
+
+        // Allocator-aware so map nodes hand their resource down to the order vector
+        explicit Level(const allocator_type& alloc = {}) : orders(alloc) {}
+        Level(const Level& other, const allocator_type& alloc) : orders(other.orders, alloc), size(other.size), count(other.count) {}
+        Level(Level&& other, const allocator_type& alloc) : orders(std::move(other.orders), alloc), size(other.size), count(other.count) {}
+        Level(const Level&) = default;
+        Level(Level&&) = default;
+
+        void push(const databento::MboMsg& o);
+        void erase(std::pmr::vector<databento::MboMsg>::iterator it);
+        void resize(databento::MboMsg& o, std::uint32_t sz) { size = size - o.size + sz; o.size = sz; }
+        // Recounts from the orders; true when the maintained totals disagree
+        bool totals_mismatch() const;
+    };
+    using Levels = std::pmr::map<std::int64_t, Level>; // ascending; bids are read from the back
+
+    // index: dense book number assigned by the owner. expected_orders pre-sizes the order-id
+    // index so it does not rehash while filling up.
+    MboBook(std::uint16_t publisher_id, std::uint32_t index, std::pmr::memory_resource* resource,
+            std::size_t expected_orders = 0);
+    // Moves keep the resource; copies would silently fall back to the default one
+    MboBook(MboBook&&) = default;
+    MboBook& operator=(MboBook&&) = default;
+    MboBook(const MboBook&) = delete;
+    MboBook& operator=(const MboBook&) = delete;
+
+    MboApplyResult apply(const databento::MboMsg& mbo);
+
+    std::uint16_t publisher_id() const { return publisher_id_; }
+    std::uint32_t index() const { return index_; }
+    const Levels& bids() const { return bids_; }
+    const Levels& asks() const { return asks_; }
+    // Best-first levels into the row buffers (cleared first), at most depth per side
+    void top_levels(std::size_t depth, std::vector<LevelSnapshot>& bids, std::vector<LevelSnapshot>& asks) const;
+    // All levels, best first; returns the number of levels whose totals failed a recount
+    // when recount is set (0 otherwise)
+    std::uint64_t snapshot(PublisherSnapshot& out, bool recount) const;
+
+private:
+    struct OrderRef {
+        std::int64_t price;
+        databento::Side side;
+    };
+    Levels& side_of(databento::Side side) { return side == databento::Side::Bid ? bids_ : asks_; }
+
+    std::uint16_t publisher_id_;
+    std::uint32_t index_;
+    Levels bids_;
+    Levels asks_;
+    std::pmr::unordered_map<std::uint64_t, OrderRef> by_id_;
+};
+
+//  Every (instrument, publisher) book of a replay. Instrument ids go through a DenseIdIndex
+//  and publisher ids through a direct table, both once per new id; each instrument slot keeps
+//  its publisher books contiguously in first-seen order with a dense-publisher -> book table,
+//  so routing a record is array indexing. The last routed instrument is cached since MBO
+//  streams arrive in per-instrument bursts. Not synchronized: owned by the replay thread.
+//
+//  Book memory comes from one unsynchronized pool resource: freed level nodes, order vectors
+//  and index nodes go back to per-size free lists and are reused, so once the books reach
+//  their working size applying records performs no heap allocation. Only new instruments,
+//  publishers, order-index rehashes and pool chunk growth allocate (warm-up).
+class BookManager {
+public:
+    struct Instrument {
+        std::uint32_t instrument_id = 0;
+        std::uint64_t seq = 0;                 // caller's sequence at the last update (analytics dirty check)
+        std::vector<MboBook> books;            // first-seen publisher order
+        std::vector<std::uint32_t> book_of;    // dense publisher index -> position in books, or kNone
+    };
+    static constexpr std::uint32_t kNone = DenseIdIndex::kNone;
+
+    explicit BookManager(std::size_t expected_instruments = 64, std::size_t expected_orders_per_book = 256);
+    BookManager(const BookManager&) = delete;
+    BookManager& operator=(const BookManager&) = delete;
+
+    // Routes the record to its book (created on first sight), applies it and stamps seq.
+    // `book`, when given, receives the book the record was applied to.
+    MboApplyResult apply(const databento::MboMsg& mbo, std::uint64_t seq, const MboBook** book = nullptr);
+
+    // Book for the pair, created on first sight. The reference is invalidated by the next call
+    // that creates an instrument or a book.
+    MboBook& route(std::uint32_t instrument_id, std::uint16_t publisher_id);
+    Instrument& instrument(std::uint32_t instrument_id);
+
+    // Lookups that never create; nullptr when the id (pair) has not been seen
+    const Instrument* find(std::uint32_t instrument_id) const;
+    const MboBook* find(std::uint32_t instrument_id, std::uint16_t publisher_id) const;
+    std::uint32_t instrument_index(std::uint32_t instrument_id) const { return index_.find(instrument_id); }
+    std::uint32_t publisher_index(std::uint16_t publisher_id) const {
+        return publisher_id < publisher_index_.size() ? publisher_index_[publisher_id] : kNone;
+    }
+
+    // Dense iteration in first-seen order
+    const std::vector<Instrument>& instruments() const { return instruments_; }
+    std::size_t instrument_count() const { return instruments_.size(); }
+    std::size_t publisher_count() const { return publisher_ids_.size(); }
+    std::size_t book_count() const { return book_count_; } // MboBook::index() is below this
+    template <class F> // f(const Instrument&, const MboBook&)
+    void for_each_book(F&& f) const {
+        for (const auto& inst : instruments_)
+            for (const auto& book : inst.books) f(inst, book);
+    }
+
+    // All books, every level, with the aggregated BBO per instrument. With recount set every
+    // level is also recounted from its orders into out.level_total_mismatches.
+    void snapshot(BookSnapshot& out, bool recount) const;
+
+private:
+    std::uint32_t publisher_slot(std::uint16_t publisher_id);
+    std::uint32_t instrument_slot(std::uint32_t instrument_id);
+
+    std::unique_ptr<std::pmr::unsynchronized_pool_resource> pool_; // declared first: outlives the books
+    DenseIdIndex index_;
+    std::size_t expected_orders_per_book_;
+    std::uint32_t book_count_ = 0;
+    std::vector<Instrument> instruments_;
+    std::vector<std::uint32_t> publisher_index_; // publisher_id -> dense index, or kNone
+    std::vector<std::uint16_t> publisher_ids_;   // dense index -> publisher_id
+    std::uint32_t last_instrument_id_ = 0;
+    std::uint32_t last_slot_ = kNone;
+};
+
+#endif // HFT_HAS_DATABENTO
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "snapshot.h"
+
+// Structure-of-arrays copy of one book side, best level first.
+// Prices must be defined (no kSnapshotUndefPrice entries).
+struct DepthColumns {
+    std::vector<std::int64_t> price;
+    std::vector<std::uint32_t> size;
+    std::vector<std::uint32_t> count;
+
+    std::size_t levels() const { return price.size(); }
+    void clear() { price.clear(); size.clear(); count.clear(); }
+    void reserve(std::size_t n) { price.reserve(n); size.reserve(n); count.reserve(n); }
+    void push(std::int64_t px, std::uint32_t sz, std::uint32_t ct) {
+        price.push_back(px);
+        size.push_back(sz);
+        count.push_back(ct);
+    }
+};
+
+struct VwapFill {
+    std::uint64_t filled = 0;     // contracts available up to the target (<= target)
+    double notional = 0.0;        // sum(price * qty) in raw price units
+    double vwap = 0.0;            // notional / filled, raw price units (0 when nothing filled)
+    std::size_t levels_used = 0;  // levels touched, including a partially consumed one
+};
+
+//  Depth scans over DepthColumns. The per-side kernels have a scalar and an AVX2 implementation;
+//  the AVX2 path is chosen once at startup when the CPU supports it (HFT_DISABLE_SIMD=1 forces scalar).
+//  best_across works on a handful of publisher candidates and is scalar only.
+namespace depth {
+
+// out[i] = size[0] + ... + size[i]
+void cumulative(const std::uint32_t* size, std::size_t n, std::uint64_t* out);
+std::uint64_t total(const std::uint32_t* size, std::size_t n);
+
+// Cost of taking `target` contracts walking levels best-first
+VwapFill vwap_to_size(const std::int64_t* price, const std::uint32_t* size, std::size_t n, std::uint64_t target);
+
+// Best price across candidates (highest for bids, lowest for asks); undefined prices are
+// skipped. Size and count are summed over candidates at the best price.
+LevelSnapshot best_across(const std::int64_t* price, const std::uint32_t* size, const std::uint32_t* count,
+                          std::size_t n, bool highest);
+
+// "avx2" or "scalar". AVX2 is only selected after a startup parity check against the
+// scalar kernels on pseudo-random columns; a mismatch keeps scalar and says so here.
+const char* active_isa();
+
+} // namespace depth
@@ -1,27 +1,64 @@
 #pragma once
 
 #include <string>
+#include <chrono>
+#include <vector>
 #include <memory>
 #include <cstddef>
+#include <mutex>
 #include "orderbook.h"
+#include "snapshot.h"
+#include "sampler.h"
+#include "mbp_feed.h"
+#include "analytics.h"
+#include "verifier.h"
 #include "logger.h"
 #include "metrics.h"
+#include "notifier.h"
+#include "rcu.h"
+#include "mbo_source.h" // defines HFT_HAS_DATABENTO when the Databento headers are available
 
-#ifdef __has_include
-#  if __has_include(<databento/record.hpp>)
-#    include <databento/record.hpp>
-#    include <databento/enums.hpp>
-#    include <databento/dbn_file_store.hpp>
-#    define HFT_HAS_DATABENTO 1
-#  endif
-#endif
+// Live tail: keep reading the input as it grows and publish new book versions
+struct FollowOptions {
+    bool enabled = false;
+    std::chrono::milliseconds publish_interval{100}; // minimum spacing between published versions
+    std::chrono::milliseconds poll_interval{250};    // change check when inotify is unavailable
+};
+
+// One published book version: the snapshot and every body derived from it
+struct PublishedBook {
+    std::shared_ptr<const BookSnapshot> snapshot;
+    std::shared_ptr<const std::string> json; // snapshot_to_json(*snapshot)
+    std::shared_ptr<const BookAnalytics> analytics;
+    std::shared_ptr<const std::string> analytics_json;
+    uint64_t version = 0;
+};
 
 class Engine {
 public:
     explicit Engine(std::string dbn_path = "");
-    void set_dbn_path(const std::string& path) { dbn_path_ = path; }
+    ~Engine();
+    void set_dbn_path(const std::string& path) { dbn_paths_.assign(1, path); }
+    // Several inputs (e.g. per day / per venue) are decoded in parallel and merged by ts_recv
+    void set_dbn_paths(std::vector<std::string> paths) { dbn_paths_ = std::move(paths); }
+    const std::vector<std::string>& dbn_paths() const { return dbn_paths_; }
+    // Time-series capture for the next save_aggregated_orderbook replay
+    void set_sampler_config(SamplerConfig config) { sampler_config_ = std::move(config); }
+    // Derived MBP-10 DBN file for the next save_aggregated_orderbook replay
+    void set_mbp_config(MbpFeedConfig config) { mbp_config_ = std::move(config); }
+    // Analytics derived on every publish (imbalance depth, curve length, sweep sizes)
+    void set_analytics_config(AnalyticsConfig config);
+    // With follow enabled, reconstruct_snapshot() keeps applying appended records and publishing
+    // until request_stop(); only the first input is followed, and only by the first caller
+    // (later calls return an error snapshot)
+    void set_follow_options(FollowOptions options) { follow_ = options; }
+    // Records applied before ingest allocations are counted (books and pools growing to size)
+    void set_alloc_warmup(uint64_t messages) { alloc_warmup_messages_ = messages; }
+    // Audits published snapshots on a side thread (sampled); results are exposed in Metrics
+    void start_verifier(VerifierOptions options = {});
     void init();
-    void request_stop() { running_.store(false, std::memory_order_relaxed); }
+    // Takes the notifier mutex: call from a normal thread, never from a signal handler
+    void request_stop() { running_.store(false, std::memory_order_relaxed); updates_.shutdown(); }
     bool is_running() const { return running_.load(std::memory_order_relaxed); }
 
     // Replay a DBN file if Databento headers are available
@@ -29,22 +66,63 @@ public:
     // Reconstruct full order book across publishers and output JSON summary.
     // levels parameter controls how many price levels per side to include for each publisher book.
     std::string reconstruct_orderbook_json(std::size_t levels = 5) const;
+    // All levels; error set on failure. An optional sampler receives top-N rows during replay;
+    // an optional MBP writer receives a record whenever a book's top levels change.
+    BookSnapshot reconstruct_snapshot(BookSampler* sampler = nullptr, MbpFeedWriter* mbp = nullptr) const;
     void save_aggregated_orderbook_json(const std::string& path, std::size_t levels = 5) const;
+    // Replays (sampling if configured), publishes the full snapshot, and writes it to path
+    void save_aggregated_orderbook(const std::string& path, std::size_t levels, SnapshotFormat format) const;
+
+    // Latest published aggregated book (null until the first publish) and the version it was
+    // published under. Publishing bumps the version and wakes consumers in wait_for_book_update.
+    // Versions are swapped in through an RCU cell: readers on any thread get a consistent,
+    // immutable view without locking, and the replay thread never waits on them. The live
+    // reconstruction state is private to the replay thread and is only reachable this way.
+    void publish_snapshot(std::shared_ptr<const BookSnapshot> snap) const;
+    // Every published body of one version at once (version 0 and null members before the first publish)
+    PublishedBook published() const;
+    std::shared_ptr<const BookSnapshot> published_snapshot(uint64_t* version = nullptr) const;
+    std::shared_ptr<const std::string> published_orderbook_json(uint64_t* version = nullptr) const;
+    // Analytics of the published book; same version as the snapshot they were derived from
+    std::shared_ptr<const BookAnalytics> published_analytics(uint64_t* version = nullptr) const;
+    std::shared_ptr<const std::string> published_analytics_json(uint64_t* version = nullptr) const;
+    uint64_t book_version() const { return updates_.version(); }
+    template <class Rep, class Period>
+    uint64_t wait_for_book_update(uint64_t seen, const std::chrono::duration<Rep, Period>& timeout) const {
+        return updates_.wait_for_change(seen, timeout);
+    }
+
+    // Applies a decoded record to the live book (replay thread); unknown order ids and actions
+    // are counted in Metrics, as for the DBN replay path
+    OrderBookChange apply_update(const DBNRecord& record);
 
     // Access JSON representation of current book
     std::string orderbook_json(bool pretty = true) const { return book_.to_json(pretty); }
     void save_book_json(const std::string& path, bool pretty = true) const { book_.save_json(path, pretty); }
+    void save_book(const std::string& path, SnapshotFormat format) const;
 
     // Access performance metrics
     const Metrics& get_metrics() const { return metrics_; }
 
 private:
-    std::string dbn_path_;
+    std::vector<std::string> dbn_paths_;
+    SamplerConfig sampler_config_{};
+    MbpFeedConfig mbp_config_{};
+    FollowOptions follow_{};
+    uint64_t alloc_warmup_messages_ = 10000;
     OrderBook book_{}; // uses default constructor
     mutable Metrics metrics_{}; // mutable for const reconstruct_orderbook_json
     mutable std::atomic<bool> running_{true};
+    mutable std::atomic<bool> following_{false}; // set by the one reconstruct_snapshot() that follows
+    mutable UpdateNotifier updates_{};
+    mutable RcuCell<PublishedBook> published_;
+    mutable std::mutex publish_mutex_; // serializes publishers (tracker + RCU writer side); readers never take it
+    mutable AnalyticsTracker analytics_{};
+    mutable std::atomic<bool> level_recount_requested_{false}; // set by the verifier, consumed by the next build
+    std::unique_ptr<BookVerifier> verifier_;
 
 #ifdef HFT_HAS_DATABENTO
-    DBNRecord map_mbo(const databento::MboMsg& mbo) const;
+    // Dispatches straight from the DBN action enum to the typed OrderBook entry points
+    void apply_mbo(const databento::MboMsg& mbo);
 #endif
 };
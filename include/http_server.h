@@ -0,0 +1,132 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Minimal HTTP/1.1 request as seen by route handlers
+struct HttpRequest {
+    std::string method;
+    std::string path;
+    std::string query;
+    std::vector<std::pair<std::string, std::string>> headers;
+
+    // Case-insensitive header lookup; empty string if absent
+    std::string header(const std::string& name) const;
+};
+
+// Response filled in by a handler. `body` is shared so cached payloads are not copied per client.
+// Setting `stream` turns the connection into a server-sent-events stream that receives broadcasts
+// on `stream_channel`.
+struct HttpResponse {
+    int status = 200;
+    std::string content_type = "application/json";
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::shared_ptr<const std::string> body;
+    bool stream = false;
+    std::string stream_channel; // "" is the default channel
+
+    void set_content(std::string content, std::string type) {
+        body = std::make_shared<const std::string>(std::move(content));
+        content_type = std::move(type);
+    }
+    void set_header(std::string name, std::string value) { headers.emplace_back(std::move(name), std::move(value)); }
+};
+
+struct EpollServerOptions {
+    std::size_t max_connections = 65536;
+    std::size_t max_request_bytes = 16 * 1024;              // header + body cap per request; also caps buffered input
+    std::size_t max_pending_bytes = 4 * 1024 * 1024;        // per-connection write buffer cap
+    std::chrono::milliseconds slow_client_timeout{10000};   // evict when no write progress for this long
+    std::chrono::milliseconds idle_timeout{60000};          // close idle keep-alive connections
+    std::chrono::milliseconds heartbeat{15000};             // SSE comment on quiet streams
+};
+
+// Callbacks from the loop thread for connection accounting
+struct EpollServerHooks {
+    std::function<void()> on_stream_open;
+    std::function<void()> on_stream_close;
+    std::function<void(std::size_t)> on_events_sent; // receivers of one broadcast
+    std::function<void()> on_event_dropped;          // stream skipped an event (buffer full)
+    std::function<void()> on_evicted;                // slow client disconnected
+};
+
+//  Single-threaded non-blocking HTTP/SSE server on epoll.
+//  All sockets are multiplexed by one loop thread; each connection owns a bounded
+//  queue of shared payload references, so fan-out costs one pointer per client.
+class EpollHttpServer {
+public:
+    using Handler = std::function<void(const HttpRequest&, HttpResponse&)>;
+
+    explicit EpollHttpServer(EpollServerOptions options = {}, EpollServerHooks hooks = {});
+    ~EpollHttpServer();
+    EpollHttpServer(const EpollHttpServer&) = delete;
+    EpollHttpServer& operator=(const EpollHttpServer&) = delete;
+
+    void route(const std::string& path, Handler handler) { routes_[path] = std::move(handler); }
+
+    // Bind and run the event loop until stop(). Returns false if the socket could not be set up.
+    bool listen(const std::string& host, int port);
+    void stop();
+
+    // Thread-safe: queue an SSE payload for every stream connection on `channel`.
+    // The latest broadcast per channel is also sent to streams that connect afterwards.
+    void broadcast(std::shared_ptr<const std::string> event, const std::string& channel = {});
+
+    std::size_t open_connections() const { return open_connections_.load(std::memory_order_relaxed); }
+
+private:
+    using clock = std::chrono::steady_clock;
+    struct Chunk {
+        std::shared_ptr<const std::string> data;
+        std::size_t offset = 0;
+    };
+    struct Connection {
+        int fd = -1;
+        std::string in;
+        std::deque<Chunk> out;
+        std::size_t pending = 0;
+        bool streaming = false;
+        std::string channel;
+        bool close_after_write = false;
+        bool want_write = false;
+        bool read_paused = false; // input buffer full while a response drains: EPOLLIN is off
+        clock::time_point last_activity;
+        clock::time_point last_progress;
+        clock::time_point last_write;
+    };
+
+    void accept_all();
+    void on_readable(Connection& c);
+    void on_writable(Connection& c);
+    bool process_requests(Connection& c);
+    void send_response(Connection& c, const HttpRequest& req, HttpResponse& res, bool keep_alive);
+    void enqueue(Connection& c, std::shared_ptr<const std::string> data);
+    void update_interest(Connection& c);
+    void close_connection(int fd);
+    void drain_broadcasts();
+    void sweep(clock::time_point now);
+
+    EpollServerOptions options_;
+    EpollServerHooks hooks_;
+    std::unordered_map<std::string, Handler> routes_;
+    std::unordered_map<int, Connection> conns_;
+    int listen_fd_ = -1;
+    int epoll_fd_ = -1;
+    int wake_fd_ = -1;
+    std::atomic<bool> running_{true}; // stop() before listen() makes listen() return immediately
+    std::atomic<std::size_t> open_connections_{0};
+
+    std::mutex broadcast_mutex_;
+    std::vector<std::pair<std::string, std::shared_ptr<const std::string>>> pending_broadcasts_;
+    std::unordered_map<std::string, std::shared_ptr<const std::string>> last_broadcast_; // per channel; loop thread only
+    std::shared_ptr<const std::string> heartbeat_;
+};
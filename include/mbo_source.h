@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef __has_include
+#  if __has_include(<databento/record.hpp>)
+#    include <databento/record.hpp>
+#    include <databento/enums.hpp>
+#    include <databento/dbn_file_store.hpp>
+#    define HFT_HAS_DATABENTO 1
+#  endif
+#endif
+
+// Expands a comma-separated input spec into DBN file paths. Each entry may be a file,
+// a directory (its *.dbn / *.dbn.zst files) or a glob pattern; results keep entry order,
+// are sorted within an entry and deduplicated. Unmatched patterns are kept verbatim so
+// the open error names them.
+std::vector<std::string> expand_dbn_inputs(const std::string& spec);
+
+#ifdef HFT_HAS_DATABENTO
+
+struct MergeOptions {
+    std::size_t batch_records = 4096;   // records handed from a decoder to the merger at once
+    std::size_t readahead_batches = 8;  // decoded batches buffered per file
+};
+
+//  Pulls MBO records from one or more DBN files in ts_recv order. Each file must be
+//  ts_recv-ordered (as Databento MBO files are); equal timestamps keep input order.
+//  With several files every file is decoded on its own thread into a bounded queue and
+//  the consumer k-way merges the queue heads through a min-heap. A single file is
+//  decoded inline with no handoff.
+class MergedMboReader {
+public:
+    explicit MergedMboReader(std::vector<std::string> paths, MergeOptions options = {});
+    ~MergedMboReader(); // stops and joins decoder threads
+    MergedMboReader(const MergedMboReader&) = delete;
+    MergedMboReader& operator=(const MergedMboReader&) = delete;
+
+    // Next record in merged order, valid until the following call; nullptr after the last one.
+    // Rethrows the first error raised while opening or decoding any input.
+    const databento::MboMsg* next();
+    std::size_t sources() const { return sources_.size(); }
+    // Heap allocations made so far by the decoder threads (HFT_COUNT_ALLOCATIONS builds; 0 otherwise)
+    std::uint64_t decoder_allocations() const { return decoder_allocations_.load(std::memory_order_relaxed); }
+
+private:
+    struct Source;
+    bool advance(Source& s);
+    void stop();
+
+    MergeOptions options_;
+    std::vector<std::unique_ptr<Source>> sources_;
+    std::vector<std::pair<std::uint64_t, std::size_t>> heap_; // (ts_recv, source index) min-heap
+    Source* last_ = nullptr;                                    // source of the record returned last
+    bool started_ = false;
+    std::atomic<bool> stop_{false};
+    std::atomic<std::uint64_t> decoder_allocations_{0};
+};
+
+//  Follows a growing, uncompressed DBN file. Bytes are read as they are appended; next()
+//  yields MBO records only once they are complete, so a record half-written by the capture
+//  process stays buffered until the rest lands. Change notification uses inotify and falls
+//  back to sleeping for poll_interval when inotify is unavailable (e.g. network filesystems).
+//  Records are taken as-is from the file: MBO layout is the same in DBN versions 1-3.
+class DbnTailReader {
+public:
+    // Throws std::runtime_error if the file cannot be opened
+    explicit DbnTailReader(const std::string& path, std::chrono::milliseconds poll_interval = std::chrono::milliseconds(250));
+    ~DbnTailReader();
+    DbnTailReader(const DbnTailReader&) = delete;
+    DbnTailReader& operator=(const DbnTailReader&) = delete;
+
+    // Next complete MBO record among the bytes read so far; nullptr when none is buffered.
+    // Throws on a compressed or malformed file.
+    const databento::MboMsg* next();
+    // Reads what was appended since the last call (bounded per call); returns bytes read.
+    // Throws if the file shrank (rotated or truncated under us).
+    std::size_t refill();
+    // Blocks until the file changes or timeout elapses
+    void wait(std::chrono::milliseconds timeout);
+
+    bool using_inotify() const { return inotify_fd_ >= 0; }
+    std::uint64_t offset() const { return buffer_base_ + pos_; } // end of the last consumed record
+
+private:
+    bool parse_header();
+
+    std::string path_;
+    std::chrono::milliseconds poll_interval_;
+    int fd_ = -1;
+    int inotify_fd_ = -1;
+    // Read/write cursors over a fixed buffer: [pos_, end_) is read but not yet consumed. The
+    // unread bytes move to the front only when the back is full and the consumed front is over
+    // half the buffer; the buffer grows only when a partial record fills more than that.
+    std::vector<char> buffer_;
+    std::size_t pos_ = 0;              // consumed bytes in buffer_
+    std::size_t end_ = 0;              // bytes read into buffer_
+    std::uint64_t buffer_base_ = 0;    // file offset of buffer_[0]
+    bool header_done_ = false;
+    databento::MboMsg current_{};
+};
+
+#endif // HFT_HAS_DATABENTO
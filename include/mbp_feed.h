@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "book_manager.h"
+
+struct MbpFeedConfig {
+    std::string path;                   // empty = feed disabled
+    std::size_t depth = 10;             // levels watched for changes and filled (1..10)
+    std::size_t buffer_bytes = 1 << 20; // records are flushed once this much is buffered
+
+    bool enabled() const { return !path.empty(); }
+};
+
+class MbpFeedWriter; // defined only when the Databento headers are available
+
+#ifdef HFT_HAS_DATABENTO
+
+//  Derives a market-by-price feed from the MBO replay: after every applied record the
+//  publisher book's top `depth` levels are compared with the last ones written for that
+//  book, and a record is appended when any of them changed. Records are databento::Mbp10Msg
+//  (rtype 0x0A, 368 bytes) with the triggering event's price/size/action/side/flags/
+//  timestamps, `depth` set to the first level that changed and levels past `depth` left
+//  undefined. Trades do not change the levels; as in Databento MBP-10 data they are written
+//  with `depth` set to the resting level at the trade price (opposite the aggressor side).
+//  A trade whose price is not among the watched levels has no level to point at and is
+//  skipped.
+//  The file is uncompressed DBN v2 with schema mbp-10 and stype instrument_id; the
+//  header's start/end are filled in by finish() from the first and last ts_recv written.
+class MbpFeedWriter {
+public:
+    explicit MbpFeedWriter(const MbpFeedConfig& config); // throws std::runtime_error on open failure
+    ~MbpFeedWriter();
+    MbpFeedWriter(const MbpFeedWriter&) = delete;
+    MbpFeedWriter& operator=(const MbpFeedWriter&) = delete;
+
+    // Call after `mbo` was applied to `book`; returns true when a record was appended
+    bool on_update(const databento::MboMsg& mbo, const MboBook& book);
+    void flush();
+    // Flushes and patches the header time range; later calls are no-ops
+    void finish();
+    std::uint64_t records_written() const { return records_; }
+
+private:
+    using Levels = std::array<databento::BidAskPair, 10>;
+    void top_of(const MboBook& book, Levels& out) const;
+
+    MbpFeedConfig config_;
+    std::ofstream out_;
+    std::string buffer_;
+    std::vector<Levels> last_; // by MboBook::index(): levels of the last record written (empty book initially)
+    std::uint64_t first_ts_ = 0;
+    std::uint64_t last_ts_ = 0;
+    std::uint64_t records_ = 0;
+    bool finished_ = false;
+};
+
+#endif // HFT_HAS_DATABENTO
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <vector>
 #include <algorithm>
@@ -7,23 +8,62 @@
 #include <string>
 #include <mutex>
 
+struct LatencyPercentiles {
+    double p50 = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+};
+
 //  metrics collector for latency and throughput
 struct Metrics {
     // Counters
     std::atomic<uint64_t> total_messages{0};
     std::atomic<uint64_t> decode_errors{0};      // malformed or failed record decode
     std::atomic<uint64_t> replay_errors{0};      // exceptions during replay loop
+    std::atomic<uint64_t> unknown_actions{0};    // MBO actions with no book handler
+    std::atomic<uint64_t> sampled_rows{0};       // time-series rows written by the sampler
+    std::atomic<uint64_t> mbp_records{0};        // MBP-10 records written to the derived feed
+    std::atomic<uint64_t> orphan_cancels{0};     // cancel for an order id not in the book
+    std::atomic<uint64_t> orphan_fills{0};       // fill for an order id not in the book
+    std::atomic<uint64_t> orphan_modifies{0};    // modify for an order id not in the book (applied as add)
+    // Book verifier: cumulative audit counts, then gauges from the latest audit
+    std::atomic<uint64_t> audits_run{0};
+    std::atomic<uint64_t> audits_failed{0};
+    std::atomic<uint64_t> crossed_books{0};
+    std::atomic<uint64_t> crossed_aggregated{0};
+    std::atomic<uint64_t> ladder_violations{0};
+    std::atomic<uint64_t> empty_levels{0};
+    std::atomic<uint64_t> bbo_mismatches{0};
+    std::atomic<uint64_t> level_total_mismatches{0};
+    std::atomic<uint64_t> retired_book_views{0}; // published versions awaiting reclamation (readers may hold them)
+    // Heap allocations on the ingest path after warm-up: decode and hand-off (replay and decoder
+    // threads), book update and MBP output; sampling and publishing are excluded (HFT_COUNT_ALLOCATIONS builds only)
+    std::atomic<uint64_t> ingest_allocations{0};
+    std::atomic<uint64_t> ingest_alloc_messages{0}; // messages measured
     uint64_t replay_duration_ns = 0; // total elapsed time for replay
 
-    // Last error message 
+    // Last error message; the version counts set_last_error() calls (cache fingerprints)
     void set_last_error(const std::string& msg);
     std::string last_error() const;
+    uint64_t last_error_version() const { return last_error_version_.load(std::memory_order_acquire); }
 
-    // Latency recording
+    // Latency recording: a fixed window of the most recent kLatencyWindow samples, allocated
+    // once on the first sample so recording never allocates afterwards. Each sample also
+    // updates a log-linear histogram of the window (exact below 64 ns, buckets ~3% wide above)
+    static constexpr size_t kLatencyWindow = size_t{1} << 20;
+    static constexpr size_t kLatencyBuckets = 64 + 58 * 32;
     void record_latency(uint64_t ns);
-    double p50() const;
-    double p95() const;
-    double p99() const;
+    uint64_t latency_samples() const; // total recorded, including samples that left the window
+    // All percentiles from one walk over the histogram (bucket midpoints); never sorts samples
+    LatencyPercentiles percentiles() const;
+    double p50() const { return percentiles().p50; }
+    double p95() const { return percentiles().p95; }
+    double p99() const { return percentiles().p99; }
+
+    double ingest_allocs_per_million() const {
+        const uint64_t n = ingest_alloc_messages.load();
+        return n == 0 ? 0.0 : ingest_allocations.load() * 1e6 / static_cast<double>(n);
+    }
 
     double throughput_msg_per_sec() const {
         if (replay_duration_ns == 0) return 0.0;
@@ -33,8 +73,11 @@ struct Metrics {
     bool p99_exceeds(uint64_t threshold_ns) const { return p99() > static_cast<double>(threshold_ns); }
 
 private:
-    mutable std::vector<uint64_t> latencies_;
+    std::vector<uint16_t> latency_buckets_; // histogram bucket per sample; ring once the window is full
+    std::array<uint32_t, kLatencyBuckets> latency_histogram_{};
+    uint64_t latency_count_ = 0;
     mutable std::mutex latency_mutex_;
     mutable std::mutex error_mutex_;
     mutable std::string last_error_message_;
+    std::atomic<uint64_t> last_error_version_{0};
 };
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+//  Book version counter with blocking wait for change (drives /stream)
+class UpdateNotifier {
+public:
+    uint64_t version() const { return version_.load(std::memory_order_acquire); }
+
+    // Bump the version and wake every waiter
+    uint64_t publish() {
+        uint64_t v;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            v = version_.fetch_add(1, std::memory_order_acq_rel) + 1;
+        }
+        cv_.notify_all();
+        return v;
+    }
+
+    // Release all waiters permanently (shutdown)
+    void shutdown() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            shutdown_ = true;
+        }
+        cv_.notify_all();
+    }
+    bool is_shutdown() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return shutdown_;
+    }
+
+    // Block until version differs from `seen`, shutdown, or timeout.
+    // Returns the current version (== seen on timeout/shutdown).
+    template <class Rep, class Period>
+    uint64_t wait_for_change(uint64_t seen, const std::chrono::duration<Rep, Period>& timeout) const {
+        return wait_for_change(seen, timeout, [] { return false; });
+    }
+    // Same, also returning once `cancel()` holds; whoever makes it true calls wake()
+    template <class Rep, class Period, class Cancel>
+    uint64_t wait_for_change(uint64_t seen, const std::chrono::duration<Rep, Period>& timeout, Cancel&& cancel) const {
+        uint64_t v = version();
+        if (v != seen) return v; // fast path: no lock when already stale
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait_for(lock, timeout, [&] { return shutdown_ || cancel() || version_.load(std::memory_order_acquire) != seen; });
+        return version();
+    }
+
+    // Wake every waiter without publishing, so they re-check their cancel condition
+    void wake() const {
+        { std::lock_guard<std::mutex> lock(mutex_); }
+        cv_.notify_all();
+    }
+
+private:
+    std::atomic<uint64_t> version_{0};
+    bool shutdown_ = false;
+    mutable std::mutex mutex_;
+    mutable std::condition_variable cv_;
+};
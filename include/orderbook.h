@@ -5,6 +5,12 @@
 #include <string>
 #include <iostream>
 #include <cstdint>
+#include <functional>
+#include "snapshot.h"
+#include "verifier.h"
+
+// Book side; the char values match DBNRecord::side
+enum class BookSide : char { Bid = 'B', Ask = 'A' };
 
 // DBN Record - Normalized market data record
 struct DBNRecord {
@@ -12,7 +18,7 @@ struct DBNRecord {
     std::int64_t price;
     std::int32_t size;
     char side;        // 'B' (Bid) or 'A' (Ask)
-    char action;      // 'A' (Add), 'M' (Modify), 'C' (Cancel), 'F' (Fill)
+    char action;      // 'A' (Add), 'M' (Modify), 'C' (Cancel), 'F' (Fill); anything else is counted as unknown
 };
 
 // Order Node - Represents a single order in the book
@@ -20,7 +26,7 @@ struct OrderNode {
     std::uint64_t order_id;
     std::int64_t price;
     std::int32_t size;
-    char side;        // 'B' or 'A'
+    BookSide side;
     OrderNode* prev = nullptr;
     OrderNode* next = nullptr;
 };
@@ -32,6 +38,14 @@ struct PriceLevel {
     OrderNode* tail = nullptr;
 };
 
+// Compile-time side policy: selects the level ordering so the best price is always begin()
+template <BookSide S> struct SidePolicy;
+template <> struct SidePolicy<BookSide::Bid> { using Compare = std::greater<std::int64_t>; }; // highest first
+template <> struct SidePolicy<BookSide::Ask> { using Compare = std::less<std::int64_t>; };    // lowest first
+
+template <BookSide S>
+using LevelMap = std::map<std::int64_t, PriceLevel, typename SidePolicy<S>::Compare>;
+
 // Order Book Change - Result of applying an update
 struct OrderBookChange {
     char action;                    // 'A', 'M', 'C', 'F'
@@ -47,11 +61,15 @@ private:
     // O(1) Lookup: Maps Order ID to its corresponding OrderNode pointer
     std::unordered_map<std::uint64_t, OrderNode*> order_map_;
 
-    // Ordered containers for Best Bid/Offer (BBO) lookup
-    // Bids: Sorted descending by price (highest bid first)
-    std::map<std::int64_t, PriceLevel, std::greater<std::int64_t>> bids_;
-    // Asks: Sorted ascending by price (lowest ask first)
-    std::map<std::int64_t, PriceLevel> asks_;
+    // Ordered containers for Best Bid/Offer (BBO) lookup, ordering chosen by SidePolicy
+    LevelMap<BookSide::Bid> bids_;
+    LevelMap<BookSide::Ask> asks_;
+
+    // apply_update() outcomes; the typed entry points report through their return values instead
+    std::uint64_t unknown_actions_ = 0;
+    std::uint64_t orphan_modifies_ = 0;
+    std::uint64_t orphan_cancels_ = 0;
+    std::uint64_t orphan_fills_ = 0;
 
     // Simple memory pool (pre-allocated OrderNodes)
     static constexpr size_t MAX_ORDERS = 10000;
@@ -62,6 +80,13 @@ private:
     // Private helper functions for O(1) list manipulation
     void insert_order_into_level(PriceLevel& level, OrderNode* node);
     void remove_order_from_level(PriceLevel& level, OrderNode* node);
+    // Side-generic level maintenance; instantiated once per LevelMap type
+    template <class Levels> void link_order(Levels& levels, OrderNode* node);
+    template <class Levels> void unlink_order(Levels& levels, OrderNode* node);
+    // One runtime branch selects the side; `f` is a generic lambda taking the LevelMap
+    template <class F> decltype(auto) on_side(BookSide side, F&& f) {
+        return side == BookSide::Bid ? f(bids_) : f(asks_);
+    }
     
     OrderNode* allocate_node();
     void deallocate_node(OrderNode* node);
@@ -73,6 +98,21 @@ public:
     // Apply update using DBNRecord
     OrderBookChange apply_update(const DBNRecord& record);
 
+    // Typed entry points used by the DBN replay path (no intermediate record).
+    // Modify/cancel/fill return false when the order id is not in the book.
+    void add_order(std::uint64_t order_id, std::int64_t price, std::int32_t size, BookSide side);
+    bool modify_order(std::uint64_t order_id, std::int64_t price, std::int32_t size);
+    bool cancel_order(std::uint64_t order_id);
+    bool fill_order(std::uint64_t order_id) { return cancel_order(order_id); } // fills remove the order
+    std::uint64_t unknown_actions() const { return unknown_actions_; }
+    std::uint64_t orphan_modifies() const { return orphan_modifies_; }
+    std::uint64_t orphan_cancels() const { return orphan_cancels_; }
+    std::uint64_t orphan_fills() const { return orphan_fills_; }
+
+    // Walks every level: total_size against its order list, side ordering, crossed BBO.
+    // Not synchronized; call from the thread that applies updates.
+    AuditReport audit() const;
+
     // Get current best bid and ask
     std::pair<std::int64_t, std::int32_t> get_best_bid() const;
     std::pair<std::int64_t, std::int32_t> get_best_ask() const;
@@ -86,4 +126,8 @@ public:
     
     std::string to_json(bool pretty = true) const;
     void save_json(const std::string& path, bool pretty = true) const;
+
+    // Single-instrument snapshot (instrument/publisher id 0) for the binary and columnar writers
+    BookSnapshot snapshot(std::size_t levels = 0) const;
+    void save(const std::string& path, SnapshotFormat format) const;
 };
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+//  Single-writer RCU cell: readers get a consistent immutable T while the writer swaps in
+//  new versions without locking or waiting on them.
+//
+//  Readers announce themselves in the counter of the epoch they observed, re-check the epoch
+//  (retrying if the writer moved it) and only then load the pointer, so a node is reachable
+//  only by readers counted under an epoch <= the one it was retired in. The writer retires
+//  the old node under the current epoch and frees it once every counter it could be held
+//  under reads zero. The epoch only advances into a counter with no readers left, which
+//  keeps every registered reader inside the last kEpochs epochs. Reclamation is deferred to
+//  later publishes, never waited for; read sections are expected to be short (copy out).
+template <class T>
+class RcuCell {
+public:
+    RcuCell() = default;
+    RcuCell(const RcuCell&) = delete;
+    RcuCell& operator=(const RcuCell&) = delete;
+    ~RcuCell() {
+        delete current_.load(std::memory_order_relaxed);
+        for (auto& r : retired_) delete r.node;
+    }
+
+    // Runs fn(const T*) inside a read-side section; the pointer is null before the first
+    // publish and must not escape fn. Lock-free, callable from any thread.
+    template <class Fn>
+    auto read(Fn&& fn) const {
+        ReadSection section(*this);
+        return fn(static_cast<const T*>(current_.load(std::memory_order_seq_cst)));
+    }
+
+    // Writer only (one thread at a time): swaps in `next` and reclaims what readers released
+    void publish(std::unique_ptr<T> next) {
+        T* old = current_.exchange(next.release(), std::memory_order_seq_cst);
+        const std::uint64_t epoch = epoch_.load(std::memory_order_relaxed);
+        if (old) retired_.push_back({old, epoch});
+        if (readers_[(epoch + 1) % kEpochs].count.load(std::memory_order_seq_cst) == 0) {
+            epoch_.store(epoch + 1, std::memory_order_seq_cst);
+        }
+        reclaim();
+    }
+
+    // Versions swapped out but still possibly referenced by a reader (writer thread only)
+    std::size_t retired() const { return retired_.size(); }
+
+private:
+    static constexpr std::uint64_t kEpochs = 4;
+
+    struct alignas(64) ReaderCount {
+        std::atomic<std::uint64_t> count{0};
+    };
+    struct Retired {
+        T* node;
+        std::uint64_t epoch;
+    };
+
+    class ReadSection {
+    public:
+        explicit ReadSection(const RcuCell& cell) {
+            for (;;) {
+                const std::uint64_t epoch = cell.epoch_.load(std::memory_order_seq_cst);
+                counter_ = &cell.readers_[epoch % kEpochs].count;
+                counter_->fetch_add(1, std::memory_order_seq_cst);
+                if (cell.epoch_.load(std::memory_order_seq_cst) == epoch) return;
+                counter_->fetch_sub(1, std::memory_order_release); // writer advanced; re-register
+            }
+        }
+        ~ReadSection() { counter_->fetch_sub(1, std::memory_order_release); }
+        ReadSection(const ReadSection&) = delete;
+        ReadSection& operator=(const ReadSection&) = delete;
+
+    private:
+        std::atomic<std::uint64_t>* counter_;
+    };
+
+    // A node retired in epoch r is free once the epoch moved past r and no reader is counted
+    // under any live epoch <= r (live: the last kEpochs, see publish())
+    void reclaim() {
+        const std::uint64_t now = epoch_.load(std::memory_order_relaxed);
+        const std::uint64_t oldest = now > kEpochs ? now - kEpochs + 1 : 1;
+        std::uint64_t quiet_through = oldest - 1; // every live epoch up to here has no readers
+        while (quiet_through + 1 < now && readers_[(quiet_through + 1) % kEpochs].count.load(std::memory_order_seq_cst) == 0) {
+            ++quiet_through;
+        }
+        std::size_t kept = 0;
+        for (auto& r : retired_) {
+            if (r.epoch <= quiet_through) {
+                delete r.node;
+            } else {
+                retired_[kept++] = r;
+            }
+        }
+        retired_.resize(kept);
+    }
+
+    std::atomic<T*> current_{nullptr};
+    std::atomic<std::uint64_t> epoch_{1};
+    mutable ReaderCount readers_[kEpochs];
+    std::vector<Retired> retired_; // writer-owned
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// One immutable, versioned HTTP body with its validator and optional gzip variant
+struct CachedResponse {
+    uint64_t version = 0;
+    std::string etag;                               // quoted strong validator of the identity body
+    std::string gzip_etag;                          // distinct validator for the gzip coding (RFC 9110 8.8.3)
+    std::string content_type;
+    std::shared_ptr<const std::string> body;
+    std::shared_ptr<const std::string> gzip_body;   // null when zlib is unavailable or body is tiny
+};
+
+//  Single-slot response cache: the body is rebuilt only when the caller's version changes.
+//  Readers share the cached entry by pointer; concurrent misses build once.
+class ResponseCache {
+public:
+    ResponseCache(std::string etag_prefix, std::string content_type)
+        : etag_prefix_(std::move(etag_prefix)), content_type_(std::move(content_type)) {}
+
+    std::shared_ptr<const CachedResponse> get(uint64_t version,
+                                              const std::function<std::shared_ptr<const std::string>()>& build);
+
+    // True when an If-None-Match header value matches either variant's ETag
+    static bool not_modified(const std::string& if_none_match, const CachedResponse& entry);
+    // True when an Accept-Encoding header value accepts gzip (exact coding name, q > 0, or "*")
+    static bool accepts_gzip(const std::string& accept_encoding);
+
+private:
+    std::string etag_prefix_;
+    std::string content_type_;
+    std::mutex mutex_;        // guards current_
+    std::mutex build_mutex_;  // serializes rebuilds
+    std::shared_ptr<const CachedResponse> current_;
+};
+
+// gzip-compress a buffer; returns null if compression is not compiled in
+std::shared_ptr<const std::string> gzip_compress(const std::string& data);
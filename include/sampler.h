@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include "snapshot.h"
+
+enum class SampleFormat { Binary, Csv };
+
+struct SamplerConfig {
+    std::string path;                      // empty = sampling disabled
+    SampleFormat format = SampleFormat::Binary;
+    std::size_t depth = 10;                // levels per side in every row
+    std::uint64_t interval_ns = 0;         // sample on ts_recv grid (0 = off)
+    std::uint64_t every_events = 0;        // sample every N MBO events (0 = off)
+    std::size_t buffer_bytes = 1 << 20;    // rows are flushed once this much is buffered
+
+    bool enabled() const { return !path.empty() && (interval_ns != 0 || every_events != 0); }
+};
+
+//  Streams top-N depth rows during replay (L2 bars / sampled snapshots).
+//  Binary file: header magic "HFTL2S01"(8) u16 depth u16 reserved u32 row_bytes
+//               u64 interval_ns u64 every_events, then fixed-width LE rows:
+//    u64 ts_recv u32 instrument_id u16 publisher_id u16 levels_filled
+//    depth x { i64 bid_px i64 ask_px u32 bid_sz u32 ask_sz u32 bid_ct u32 ask_ct }
+//  CSV: one row per line with the same columns; empty levels have blank prices.
+class BookSampler {
+public:
+    explicit BookSampler(const SamplerConfig& config); // throws std::runtime_error on open failure
+    ~BookSampler();
+    BookSampler(const BookSampler&) = delete;
+    BookSampler& operator=(const BookSampler&) = delete;
+
+    // Time grid: call before applying an event. Returns true when the event crosses a grid
+    // boundary; the caller then samples the pre-event book stamped with sample_ts().
+    bool due_before(std::uint64_t ts_recv);
+    // Event grid: call after applying an event. Returns true every `every_events` events.
+    bool due_after();
+    std::uint64_t sample_ts() const { return sample_ts_; }
+    std::size_t depth() const { return config_.depth; }
+
+    // levels are best-first; at most depth() of each side are written
+    void write_row(std::uint64_t ts, std::uint32_t instrument_id, std::uint16_t publisher_id,
+                   const LevelSnapshot* bids, std::size_t n_bids,
+                   const LevelSnapshot* asks, std::size_t n_asks);
+    void flush();
+    std::uint64_t rows_written() const { return rows_; }
+
+private:
+    SamplerConfig config_;
+    std::ofstream out_;
+    std::string buffer_;
+    std::uint64_t next_boundary_ = 0;
+    std::uint64_t sample_ts_ = 0;
+    std::uint64_t events_ = 0;
+    std::uint64_t rows_ = 0;
+};
+
+// ".csv" -> Csv, anything else -> Binary
+SampleFormat sample_format_from_path(const std::string& path);
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+// Format-neutral copy of the aggregated multi-publisher book. Built once per publish and
+// rendered to JSON, fixed-layout binary or columnar encodings by the serializers below.
+
+// Sentinel for an empty side; equals databento::kUndefPrice
+constexpr std::int64_t kSnapshotUndefPrice = std::numeric_limits<std::int64_t>::max();
+
+struct LevelSnapshot {
+    std::int64_t price = kSnapshotUndefPrice; // raw fixed-point (1e-9 units)
+    std::uint32_t size = 0;
+    std::uint32_t count = 0;                  // orders excluding top-of-book records
+};
+
+struct PublisherSnapshot {
+    std::uint16_t publisher_id = 0;
+    LevelSnapshot best_bid;
+    LevelSnapshot best_ask;
+    std::vector<LevelSnapshot> bids; // best (highest) first
+    std::vector<LevelSnapshot> asks; // best (lowest) first
+};
+
+struct InstrumentSnapshot {
+    std::uint32_t instrument_id = 0;
+    std::uint64_t seq = 0;             // MBO sequence of the instrument's last update (not serialized)
+    std::vector<PublisherSnapshot> publishers;
+    LevelSnapshot agg_bid; // best bid across publishers, sizes summed at equal price
+    LevelSnapshot agg_ask;
+};
+
+struct BookSnapshot {
+    std::vector<InstrumentSnapshot> instruments;
+    std::uint64_t last_ts_recv = 0;    // UNIX nanoseconds
+    std::string last_ts_recv_iso;
+    std::uint64_t mbo_count = 0;
+    std::string error;                 // non-empty when reconstruction failed
+    // Set when the builder recounted every level from its orders (sampled; not serialized)
+    bool level_totals_audited = false;
+    std::uint64_t level_total_mismatches = 0;
+};
+
+enum class SnapshotFormat { Json, Binary, Columnar };
+
+// Content types used for negotiation on /orderbook
+constexpr const char* kJsonContentType = "application/json";
+constexpr const char* kBinaryContentType = "application/vnd.hft.book";
+constexpr const char* kColumnarContentType = "application/vnd.hft.book-columnar";
+
+// max_levels caps levels per publisher side; 0 = all
+std::string snapshot_to_json(const BookSnapshot& snap, std::size_t max_levels = 0);
+
+// Fixed-layout little-endian binary (all integers LE, no padding):
+//   header  : magic "HFTBOOK1"(8) u16 format_version u16 reserved u32 instrument_count
+//             u64 mbo_count u64 last_ts_recv
+//   instrument: u32 instrument_id u16 publisher_count u16 reserved Level agg_bid Level agg_ask
+//     publisher: u16 publisher_id u16 reserved u32 bid_count u32 ask_count
+//                Level best_bid Level best_ask Level bids[bid_count] Level asks[ask_count]
+//   Level   : i64 price u32 size u32 count   (16 bytes)
+std::string snapshot_to_binary(const BookSnapshot& snap, std::size_t max_levels = 0);
+
+// Columnar layout, one row per publisher level (Arrow-IPC style, 64-byte aligned buffers):
+//   header  : magic "HFTCOL01"(8) u32 column_count u32 reserved u64 row_count
+//             u64 mbo_count u64 last_ts_recv
+//   directory (column_count entries): char name[16] u8 type ('u'/'i') u8 byte_width u16 reserved
+//             u32 reserved u64 offset u64 length      (40 bytes; offset from file start)
+//   buffers : instrument_id u32, publisher_id u16, side u8 ('B'/'A'), depth u32,
+//             price i64, size u32, count u32
+std::string snapshot_to_columnar(const BookSnapshot& snap, std::size_t max_levels = 0);
+
+std::string serialize_snapshot(const BookSnapshot& snap, SnapshotFormat format, std::size_t max_levels = 0);
+const char* snapshot_content_type(SnapshotFormat format);
+// ".bin" -> Binary, ".col"/".arrow" -> Columnar, anything else -> Json
+SnapshotFormat snapshot_format_from_path(const std::string& path);
+// Writes the encoding to path; throws std::runtime_error if the file cannot be opened
+void save_snapshot(const BookSnapshot& snap, const std::string& path, SnapshotFormat format, std::size_t max_levels = 0);
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "metrics.h"
+#include "notifier.h"
+#include "snapshot.h"
+
+// Invariant violations found in one book view
+struct AuditReport {
+    std::uint64_t levels_checked = 0;
+    std::uint64_t crossed_books = 0;          // publisher book with best bid >= best ask
+    std::uint64_t crossed_aggregated = 0;     // consolidated bid >= ask across publishers
+    std::uint64_t ladder_violations = 0;      // levels out of price order, duplicated or undefined
+    std::uint64_t empty_levels = 0;           // resting level with size 0, or more orders than contracts
+    std::uint64_t bbo_mismatches = 0;         // best/aggregated BBO disagrees with the ladders
+    std::uint64_t level_total_mismatches = 0; // level size differs from the sum of its orders
+
+    // Crossed aggregated books are reported but not failures: venues can legitimately cross
+    bool clean() const {
+        return crossed_books == 0 && ladder_violations == 0 && empty_levels == 0 && bbo_mismatches == 0 &&
+               level_total_mismatches == 0;
+    }
+};
+
+// Structural checks over an immutable snapshot; level totals come from the builder's recount
+AuditReport audit_snapshot(const BookSnapshot& snap);
+
+struct VerifierOptions {
+    std::chrono::milliseconds interval{1000}; // minimum spacing between audits (sampling)
+};
+
+//  Audits published snapshots on its own thread. Snapshots are immutable and shared by
+//  pointer, so auditing never blocks the writer. The thread sleeps on the book notifier and
+//  wakes only for a new version (held until the sampling window closes) or stop().
+//  After each audit it asks the builder for an order-sum recount on the next publish
+//  (`request_recount`). That recount is the one part of verification that runs on the
+//  replay thread: one extra O(orders) walk inside the next snapshot build, at most once
+//  per interval. Results land in Metrics: the latest audit's violations as gauges,
+//  audits_run / audits_failed cumulatively.
+class BookVerifier {
+public:
+    using SnapshotSource = std::function<std::shared_ptr<const BookSnapshot>(std::uint64_t*)>;
+
+    BookVerifier(SnapshotSource source, const UpdateNotifier& updates, Metrics& metrics,
+                 std::function<void()> request_recount, VerifierOptions options = {});
+    ~BookVerifier();
+    BookVerifier(const BookVerifier&) = delete;
+    BookVerifier& operator=(const BookVerifier&) = delete;
+
+    void start();
+    void stop();
+
+private:
+    void run();
+
+    SnapshotSource source_;
+    const UpdateNotifier& updates_;
+    Metrics& metrics_;
+    std::function<void()> request_recount_;
+    VerifierOptions options_;
+    std::atomic<bool> running_{false};
+    std::mutex window_mutex_;            // sampling-window sleep, cut short by stop()
+    std::condition_variable window_cv_;
+    std::thread thread_;
+};
@@ -0,0 +1,58 @@
+#include "../include/alloc_counter.h"
+
+#ifdef HFT_COUNT_ALLOCATIONS
+#include <cstdlib>
+#include <new>
+
+namespace {
+thread_local std::uint64_t t_allocations = 0; // trivial types: no TLS init guard inside operator new
+thread_local std::atomic<std::uint64_t>* t_shared = nullptr;
+
+inline void count_allocation() {
+    ++t_allocations;
+    if (t_shared) t_shared->fetch_add(1, std::memory_order_relaxed);
+}
+}
+
+std::uint64_t alloc_counter::thread_allocations() {
+    return t_allocations;
+}
+
+alloc_counter::ScopedShare::ScopedShare(std::atomic<std::uint64_t>* shared) : previous_(t_shared) {
+    t_shared = shared;
+}
+
+alloc_counter::ScopedShare::~ScopedShare() {
+    t_shared = previous_;
+}
+
+// Array and nothrow forms forward to these in libstdc++/libc++, so they are counted too
+void* operator new(std::size_t size) {
+    count_allocation();
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t align) {
+    count_allocation();
+    const std::size_t a = static_cast<std::size_t>(align);
+    if (void* p = std::aligned_alloc(a, size ? (size + a - 1) / a * a : a)) return p; // size must be a multiple of a
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+#else
+
+std::uint64_t alloc_counter::thread_allocations() {
+    return 0;
+}
+
+alloc_counter::ScopedShare::ScopedShare(std::atomic<std::uint64_t>*) : previous_(nullptr) {}
+
+alloc_counter::ScopedShare::~ScopedShare() = default;
+
+#endif
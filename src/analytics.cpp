@@ -0,0 +1,201 @@
+#include "../include/analytics.h"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+
+// k-way merge of best-first publisher ladders; equal prices are summed into one level
+template <class Better>
+void merge_side(const InstrumentSnapshot& inst, std::vector<LevelSnapshot> PublisherSnapshot::*side, Better better,
+                DepthColumns& out) {
+    out.clear();
+    std::size_t total = 0;
+    for (const auto& pb : inst.publishers) total += (pb.*side).size();
+    out.reserve(total);
+    std::vector<std::size_t> pos(inst.publishers.size(), 0);
+    for (;;) {
+        bool found = false;
+        std::int64_t best = 0;
+        for (std::size_t i = 0; i < pos.size(); ++i) {
+            const auto& levels = inst.publishers[i].*side;
+            while (pos[i] < levels.size() && levels[pos[i]].price == kSnapshotUndefPrice) ++pos[i];
+            if (pos[i] == levels.size()) continue;
+            const std::int64_t px = levels[pos[i]].price;
+            if (!found || better(px, best)) { best = px; found = true; }
+        }
+        if (!found) break;
+        std::uint32_t size = 0, count = 0;
+        for (std::size_t i = 0; i < pos.size(); ++i) {
+            const auto& levels = inst.publishers[i].*side;
+            if (pos[i] < levels.size() && levels[pos[i]].price == best) {
+                size += levels[pos[i]].size;
+                count += levels[pos[i]].count;
+                ++pos[i];
+            }
+        }
+        out.push(best, size, count);
+    }
+}
+
+LevelSnapshot top_of(const DepthColumns& side) {
+    LevelSnapshot l;
+    if (side.levels() == 0) return l;
+    l.price = side.price[0];
+    l.size = side.size[0];
+    l.count = side.count[0];
+    return l;
+}
+
+// Raw fixed-point (1e-9) to decimal; `defined` false renders null
+void put_price(std::ostringstream& oss, double raw, bool defined, int places) {
+    if (!defined) { oss << "null"; return; }
+    oss << std::fixed << std::setprecision(places) << raw / 1e9;
+}
+
+void put_level(std::ostringstream& oss, const LevelSnapshot& l) {
+    oss << "{\"price\": ";
+    put_price(oss, static_cast<double>(l.price), l.price != kSnapshotUndefPrice, 2);
+    oss << ", \"size\": " << l.size << ", \"count\": " << l.count << "}";
+}
+
+void put_curve(std::ostringstream& oss, const DepthColumns& side, const std::vector<std::uint64_t>& cum) {
+    oss << "[";
+    for (std::size_t i = 0; i < cum.size(); ++i) {
+        if (i > 0) oss << ", ";
+        oss << "{\"price\": ";
+        put_price(oss, static_cast<double>(side.price[i]), true, 2);
+        oss << ", \"cum_size\": " << cum[i] << "}";
+    }
+    oss << "]";
+}
+
+void put_fill(std::ostringstream& oss, const VwapFill& f) {
+    oss << "{\"filled\": " << f.filled << ", \"vwap\": ";
+    put_price(oss, f.vwap, f.filled > 0, 4);
+    oss << ", \"levels\": " << f.levels_used << "}";
+}
+
+} // namespace
+
+void consolidate_depth(const InstrumentSnapshot& inst, DepthColumns& bids, DepthColumns& asks) {
+    merge_side(inst, &PublisherSnapshot::bids, [](std::int64_t a, std::int64_t b) { return a > b; }, bids);
+    merge_side(inst, &PublisherSnapshot::asks, [](std::int64_t a, std::int64_t b) { return a < b; }, asks);
+}
+
+InstrumentAnalytics compute_instrument_analytics(const InstrumentSnapshot& inst, const AnalyticsConfig& config) {
+    InstrumentAnalytics a;
+    a.instrument_id = inst.instrument_id;
+    a.seq = inst.seq;
+    consolidate_depth(inst, a.bids, a.asks);
+    a.bid = top_of(a.bids);
+    a.ask = top_of(a.asks);
+
+    a.two_sided = a.bids.levels() > 0 && a.asks.levels() > 0;
+    if (a.two_sided) {
+        const double bid = static_cast<double>(a.bid.price), ask = static_cast<double>(a.ask.price);
+        a.spread = a.ask.price - a.bid.price;
+        a.mid = (bid + ask) / 2.0;
+        const double qty = static_cast<double>(a.bid.size) + a.ask.size;
+        a.microprice = qty > 0 ? (bid * a.ask.size + ask * a.bid.size) / qty : a.mid;
+    }
+
+    const std::uint64_t bid_qty = depth::total(a.bids.size.data(), std::min(config.imbalance_levels, a.bids.levels()));
+    const std::uint64_t ask_qty = depth::total(a.asks.size.data(), std::min(config.imbalance_levels, a.asks.levels()));
+    if (bid_qty + ask_qty > 0) {
+        a.imbalance = (static_cast<double>(bid_qty) - static_cast<double>(ask_qty)) / static_cast<double>(bid_qty + ask_qty);
+    }
+
+    a.bid_depth.resize(std::min(config.depth_levels, a.bids.levels()));
+    a.ask_depth.resize(std::min(config.depth_levels, a.asks.levels()));
+    depth::cumulative(a.bids.size.data(), a.bid_depth.size(), a.bid_depth.data());
+    depth::cumulative(a.asks.size.data(), a.ask_depth.size(), a.ask_depth.data());
+
+    a.sweeps.reserve(config.sweep_sizes.size());
+    for (std::uint64_t target : config.sweep_sizes) {
+        SweepCost s;
+        s.target = target;
+        s.buy = depth::vwap_to_size(a.asks.price.data(), a.asks.size.data(), a.asks.levels(), target);
+        s.sell = depth::vwap_to_size(a.bids.price.data(), a.bids.size.data(), a.bids.levels(), target);
+        a.sweeps.push_back(s);
+    }
+
+    // Sweeps needed full depth; only the curve prefix is kept
+    auto keep = [](DepthColumns& side, std::size_t n) {
+        side.price.resize(n); side.size.resize(n); side.count.resize(n);
+        side.price.shrink_to_fit(); side.size.shrink_to_fit(); side.count.shrink_to_fit();
+    };
+    keep(a.bids, a.bid_depth.size());
+    keep(a.asks, a.ask_depth.size());
+    return a;
+}
+
+std::shared_ptr<const BookAnalytics> AnalyticsTracker::update(const BookSnapshot& snap) {
+    auto out = std::make_shared<BookAnalytics>();
+    out->imbalance_levels = config_.imbalance_levels;
+    out->last_ts_recv = snap.last_ts_recv;
+    out->last_ts_recv_iso = snap.last_ts_recv_iso;
+    out->mbo_count = snap.mbo_count;
+    out->instruments.reserve(snap.instruments.size());
+    for (const auto& inst : snap.instruments) {
+        auto& cached = cache_[inst.instrument_id];
+        if (!cached || cached->seq != inst.seq || inst.seq == 0) {
+            cached = std::make_shared<const InstrumentAnalytics>(compute_instrument_analytics(inst, config_));
+            ++recomputed_;
+        }
+        out->instruments.push_back(cached);
+    }
+    return out;
+}
+
+std::string analytics_to_json(const BookAnalytics& analytics) {
+    std::ostringstream oss;
+    oss << "{\n  \"instruments\": [\n";
+    bool first = true;
+    for (const auto& ptr : analytics.instruments) {
+        const InstrumentAnalytics& a = *ptr;
+        if (!first) oss << ",\n";
+        first = false;
+        oss << "    {\n      \"instrument_id\": " << a.instrument_id << ",\n      \"bbo\": {\"bid\": ";
+        put_level(oss, a.bid);
+        oss << ", \"ask\": ";
+        put_level(oss, a.ask);
+        oss << "},\n      \"spread\": ";
+        put_price(oss, static_cast<double>(a.spread), a.two_sided, 2);
+        oss << ",\n      \"mid\": ";
+        put_price(oss, a.mid, a.two_sided, 4);
+        oss << ",\n      \"microprice\": ";
+        put_price(oss, a.microprice, a.two_sided, 4);
+        oss << ",\n      \"imbalance\": " << std::fixed << std::setprecision(4) << a.imbalance;
+        oss << ",\n      \"depth\": {\"bids\": ";
+        put_curve(oss, a.bids, a.bid_depth);
+        oss << ", \"asks\": ";
+        put_curve(oss, a.asks, a.ask_depth);
+        oss << "},\n      \"sweep\": [";
+        for (std::size_t i = 0; i < a.sweeps.size(); ++i) {
+            if (i > 0) oss << ", ";
+            oss << "{\"size\": " << a.sweeps[i].target << ", \"buy\": ";
+            put_fill(oss, a.sweeps[i].buy);
+            oss << ", \"sell\": ";
+            put_fill(oss, a.sweeps[i].sell);
+            oss << "}";
+        }
+        oss << "]\n    }";
+    }
+    oss << "\n  ],\n  \"imbalance_levels\": " << analytics.imbalance_levels << ",\n  \"last_ts_recv_iso\": \""
+        << analytics.last_ts_recv_iso << "\",\n  \"mbo_count\": " << analytics.mbo_count << "\n}\n";
+    return oss.str();
+}
+
+std::vector<std::uint64_t> parse_sweep_sizes(const std::string& csv) {
+    std::vector<std::uint64_t> out;
+    std::stringstream ss(csv);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        try {
+            std::uint64_t v = std::stoull(item);
+            if (v > 0) out.push_back(v);
+        } catch (...) { /* skip malformed entry */ }
+    }
+    return out;
+}
@@ -1,100 +1,405 @@
 #include "../include/apiserver.h"
+#include "../include/depth_kernels.h"
+#include "../include/alloc_counter.h"
 #include <httplib.h>
+#include <functional>
 #include <sstream>
 #include <iomanip>
 #include <thread>
 
+namespace {
+// How long an idle stream blocks before re-checking shutdown flags
+constexpr std::chrono::milliseconds kStreamWakeInterval{1000};
+// Idle streams send an SSE comment this often so dead peers are detected
+constexpr std::chrono::seconds kStreamHeartbeat{15};
+
+bool wants_gzip(const CachedResponse& entry, const std::string& accept_encoding) {
+    return entry.gzip_body && ResponseCache::accepts_gzip(accept_encoding);
+}
+
+// Revalidation headers shared by both backends; body variant (and its own ETag) picked from Accept-Encoding
+template <class SetHeader>
+const std::shared_ptr<const std::string>& cached_variant(const CachedResponse& entry, const std::string& accept_encoding,
+                                                         SetHeader&& set_header) {
+    const bool gzip = wants_gzip(entry, accept_encoding);
+    set_header("ETag", gzip ? entry.gzip_etag : entry.etag);
+    set_header("Cache-Control", "no-cache");
+    set_header("Vary", "Accept, Accept-Encoding");
+    if (gzip) {
+        set_header("Content-Encoding", "gzip");
+        return entry.gzip_body;
+    }
+    return entry.body;
+}
+
+void serve_cached(const HttpRequest& req, HttpResponse& res, const CachedResponse& entry) {
+    if (ResponseCache::not_modified(req.header("If-None-Match"), entry)) {
+        res.status = 304;
+        res.set_header("ETag", wants_gzip(entry, req.header("Accept-Encoding")) ? entry.gzip_etag : entry.etag);
+        return;
+    }
+    res.content_type = entry.content_type;
+    res.body = cached_variant(entry, req.header("Accept-Encoding"),
+                              [&](const char* k, const std::string& v) { res.set_header(k, v); });
+}
+
+void serve_cached(const httplib::Request& req, httplib::Response& res, const CachedResponse& entry) {
+    if (ResponseCache::not_modified(req.get_header_value("If-None-Match"), entry)) {
+        res.status = 304;
+        res.set_header("ETag", wants_gzip(entry, req.get_header_value("Accept-Encoding")) ? entry.gzip_etag : entry.etag);
+        return;
+    }
+    const auto& body = cached_variant(entry, req.get_header_value("Accept-Encoding"),
+                                      [&](const char* k, const std::string& v) { res.set_header(k, v); });
+    res.set_content(*body, entry.content_type);
+}
+
+constexpr const char* kNotPublishedBody = "{\"error\": \"order book not yet published\"}";
+
+// ?format=json|binary|columnar wins over the Accept header; JSON is the default
+SnapshotFormat negotiate_format(const std::string& format, const std::string& accept) {
+    if (format == "binary") return SnapshotFormat::Binary;
+    if (format == "columnar") return SnapshotFormat::Columnar;
+    if (format == "json") return SnapshotFormat::Json;
+    if (accept.find(kColumnarContentType) != std::string::npos) return SnapshotFormat::Columnar;
+    if (accept.find(kBinaryContentType) != std::string::npos) return SnapshotFormat::Binary;
+    return SnapshotFormat::Json;
+}
+
+std::string query_param(const std::string& query, const std::string& name) {
+    std::size_t pos = 0;
+    while (pos <= query.size()) {
+        std::size_t amp = query.find('&', pos);
+        std::string kv = query.substr(pos, amp == std::string::npos ? std::string::npos : amp - pos);
+        if (kv.compare(0, name.size() + 1, name + "=") == 0) return kv.substr(name.size() + 1);
+        if (amp == std::string::npos) break;
+        pos = amp + 1;
+    }
+    return {};
+}
+}
+
 ApiServer::ApiServer(Engine* engine, int port) 
-    : engine_(engine), port_(port) {}
+    : engine_(engine), port_(port) {
+    // Threshold for latency spike (nanoseconds), read once
+    if (const char* envp = std::getenv("LATENCY_P99_THRESHOLD_NS")) {
+        try { p99_threshold_ns_ = static_cast<uint64_t>(std::stoull(envp)); } catch (...) {}
+    }
+    if (const char* envp = std::getenv("STREAM_COALESCE_MS")) {
+        try { stream_coalesce_ = std::chrono::milliseconds(std::stoll(envp)); } catch (...) {}
+    }
+    if (const char* envp = std::getenv("STREAM_MAX_BUFFER_BYTES")) {
+        try { epoll_options_.max_pending_bytes = static_cast<std::size_t>(std::stoull(envp)); } catch (...) {}
+    }
+    if (const char* envp = std::getenv("SLOW_CLIENT_TIMEOUT_MS")) {
+        try { epoll_options_.slow_client_timeout = std::chrono::milliseconds(std::stoll(envp)); } catch (...) {}
+    }
+}
 
 ApiServer::~ApiServer() {
     stop();
 }
 
-std::string ApiServer::handle_orderbook() {
-    // Return aggregated order book JSON snapshot (all levels)
-    return engine_->reconstruct_orderbook_json(0);
+std::shared_ptr<const CachedResponse> ApiServer::cached_orderbook(SnapshotFormat format) {
+    uint64_t version = 0;
+    if (format == SnapshotFormat::Json) {
+        auto json = engine_->published_orderbook_json(&version);
+        if (!json) return nullptr;
+        return orderbook_cache_.get(version, [&] { return json; }); // body shared as published
+    }
+    auto snap = engine_->published_snapshot(&version);
+    if (!snap) return nullptr;
+    auto& cache = (format == SnapshotFormat::Binary) ? orderbook_bin_cache_ : orderbook_col_cache_;
+    return cache.get(version, [&] { return std::make_shared<const std::string>(serialize_snapshot(*snap, format)); });
+}
+
+std::shared_ptr<const CachedResponse> ApiServer::cached_analytics() {
+    uint64_t version = 0;
+    auto json = engine_->published_analytics_json(&version);
+    if (!json) return nullptr;
+    return analytics_cache_.get(version, [&] { return json; });
+}
+
+uint64_t ApiServer::metrics_epoch() const {
+    // Fingerprint of every input to handle_metrics(); equal epochs mean identical bodies
+    const Metrics& m = engine_->get_metrics();
+    const uint64_t inputs[] = {
+        m.total_messages.load(), m.replay_errors.load(), m.decode_errors.load(), m.unknown_actions.load(), m.sampled_rows.load(), m.latency_samples(),
+        m.replay_duration_ns, static_cast<uint64_t>(connected_clients_.load()),
+        static_cast<uint64_t>(peak_connected_clients_.load()), total_connections_.load(),
+        total_events_streamed_.load(), evicted_clients_.load(), dropped_stream_events_.load(),
+        epoll_server_ ? epoll_server_->open_connections() : 0,
+        m.orphan_cancels.load(), m.orphan_modifies.load(), m.orphan_fills.load(), m.audits_run.load(), m.audits_failed.load(),
+        m.crossed_books.load(), m.crossed_aggregated.load(), m.ladder_violations.load(), m.empty_levels.load(),
+        m.bbo_mismatches.load(), m.level_total_mismatches.load(), m.retired_book_views.load(),
+        m.ingest_allocations.load(), m.ingest_alloc_messages.load(), m.mbp_records.load(),
+        m.last_error_version(),
+    };
+    uint64_t h = 1469598103934665603ull; // FNV-1a over the counters
+    for (uint64_t v : inputs) {
+        h ^= v;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+std::shared_ptr<const CachedResponse> ApiServer::cached_metrics() {
+    return metrics_cache_.get(metrics_epoch(), [this] { return std::make_shared<const std::string>(handle_metrics()); });
 }
 
 std::string ApiServer::handle_metrics() {
     const Metrics& m = engine_->get_metrics();
     std::ostringstream oss;
-    // Threshold for latency spike (nanoseconds). Can be overridden via env LATENCY_P99_THRESHOLD_NS
-    uint64_t threshold_ns = 10000000; // 10 ms default
-    if (const char* envp = std::getenv("LATENCY_P99_THRESHOLD_NS")) {
-        try { threshold_ns = static_cast<uint64_t>(std::stoull(envp)); } catch (...) {}
-    }
-    bool spike = m.p99_exceeds(threshold_ns);
+    LatencyPercentiles pct = m.percentiles();
+    bool spike = pct.p99 > static_cast<double>(p99_threshold_ns_);
     oss << "{\n"
         << "  \"connected_clients\": " << connected_clients_.load() << ",\n"
         << "  \"peak_concurrent_clients\": " << peak_connected_clients_.load() << ",\n"
         << "  \"total_connections\": " << total_connections_.load() << ",\n"
         << "  \"total_events_streamed\": " << total_events_streamed_.load() << ",\n"
+        << "  \"open_connections\": " << (epoll_server_ ? epoll_server_->open_connections() : 0) << ",\n"
+        << "  \"evicted_clients\": " << evicted_clients_.load() << ",\n"
+        << "  \"dropped_stream_events\": " << dropped_stream_events_.load() << ",\n"
         << "  \"total_messages\": " << m.total_messages.load() << ",\n"
         << "  \"replay_errors\": " << m.replay_errors.load() << ",\n"
         << "  \"decode_errors\": " << m.decode_errors.load() << ",\n"
-        << "  \"latency_ns_p50\": " << m.p50() << ",\n"
-        << "  \"latency_ns_p95\": " << m.p95() << ",\n"
-        << "  \"latency_ns_p99\": " << m.p99() << ",\n"
+        << "  \"unknown_actions\": " << m.unknown_actions.load() << ",\n"
+        << "  \"sampled_rows\": " << m.sampled_rows.load() << ",\n"
+        << "  \"mbp_records\": " << m.mbp_records.load() << ",\n"
+        << "  \"orphan_cancels\": " << m.orphan_cancels.load() << ",\n"
+        << "  \"orphan_modifies\": " << m.orphan_modifies.load() << ",\n"
+        << "  \"orphan_fills\": " << m.orphan_fills.load() << ",\n"
+        << "  \"audits_run\": " << m.audits_run.load() << ",\n"
+        << "  \"audits_failed\": " << m.audits_failed.load() << ",\n"
+        << "  \"crossed_books\": " << m.crossed_books.load() << ",\n"
+        << "  \"crossed_aggregated\": " << m.crossed_aggregated.load() << ",\n"
+        << "  \"ladder_violations\": " << m.ladder_violations.load() << ",\n"
+        << "  \"empty_levels\": " << m.empty_levels.load() << ",\n"
+        << "  \"bbo_mismatches\": " << m.bbo_mismatches.load() << ",\n"
+        << "  \"level_total_mismatches\": " << m.level_total_mismatches.load() << ",\n"
+        << "  \"retired_book_views\": " << m.retired_book_views.load() << ",\n"
+        << "  \"latency_ns_p50\": " << pct.p50 << ",\n"
+        << "  \"latency_ns_p95\": " << pct.p95 << ",\n"
+        << "  \"latency_ns_p99\": " << pct.p99 << ",\n"
         << "  \"throughput_msg_per_sec\": " << std::fixed << std::setprecision(2) << m.throughput_msg_per_sec() << ",\n"
-        << "  \"p99_threshold_ns\": " << threshold_ns << ",\n"
+        << "  \"p99_threshold_ns\": " << p99_threshold_ns_ << ",\n"
         << "  \"latency_spike\": " << (spike ? "true" : "false") << ",\n"
+        << "  \"simd_isa\": \"" << depth::active_isa() << "\",\n"
+        << "  \"alloc_tracking\": " << (alloc_counter::kEnabled ? "true" : "false") << ",\n"
+        << "  \"ingest_allocations\": " << m.ingest_allocations.load() << ",\n"
+        << "  \"ingest_allocs_per_million\": " << m.ingest_allocs_per_million() << ",\n"
         << "  \"last_error\": \"" << m.last_error() << "\"\n"
         << "}\n";
     return oss.str();
 }
 
+void ApiServer::note_stream_open() {
+    int current = connected_clients_.fetch_add(1, std::memory_order_relaxed) + 1;
+    total_connections_.fetch_add(1, std::memory_order_relaxed);
+    
+    // Update peak if current exceeds it
+    int peak = peak_connected_clients_.load(std::memory_order_relaxed);
+    while (current > peak && !peak_connected_clients_.compare_exchange_weak(peak, current, std::memory_order_relaxed)) {
+        // Retry if another thread updated peak
+    }
+}
+
 void ApiServer::start() {
-    running_ = true;
-    server_ = std::make_unique<httplib::Server>();
+    const char* backend = std::getenv("API_SERVER");
+    if (backend && std::string(backend) == "httplib") {
+        start_httplib();
+    } else {
+        start_epoll();
+    }
+}
+
+void ApiServer::start_epoll() {
+    EpollServerHooks hooks;
+    hooks.on_stream_open = [this] { note_stream_open(); };
+    hooks.on_stream_close = [this] { connected_clients_.fetch_sub(1, std::memory_order_relaxed); };
+    hooks.on_events_sent = [this](std::size_t n) { total_events_streamed_.fetch_add(n, std::memory_order_relaxed); };
+    hooks.on_event_dropped = [this] { dropped_stream_events_.fetch_add(1, std::memory_order_relaxed); };
+    hooks.on_evicted = [this] { evicted_clients_.fetch_add(1, std::memory_order_relaxed); };
+    {
+        // Once created here, a later stop() reaches the server, and its stop() before listen() sticks
+        std::lock_guard<std::mutex> lock(server_mutex_);
+        if (stop_requested_) return;
+        epoll_server_ = std::make_unique<EpollHttpServer>(epoll_options_, std::move(hooks));
+        running_ = true;
+    }
+    auto& svr = *epoll_server_;
+
+    // Handlers run on the loop thread, so they only serve published state (never replay)
+    svr.route("/orderbook", [this](const HttpRequest& req, HttpResponse& res) {
+        auto entry = cached_orderbook(negotiate_format(query_param(req.query, "format"), req.header("Accept")));
+        if (!entry) {
+            res.status = 503;
+            res.set_header("Retry-After", "1");
+            res.set_content(kNotPublishedBody, kJsonContentType);
+            return;
+        }
+        serve_cached(req, res, *entry);
+    });
+    svr.route("/analytics", [this](const HttpRequest& req, HttpResponse& res) {
+        auto entry = cached_analytics();
+        if (!entry) {
+            res.status = 503;
+            res.set_header("Retry-After", "1");
+            res.set_content(kNotPublishedBody, kJsonContentType);
+            return;
+        }
+        serve_cached(req, res, *entry);
+    });
+    svr.route("/metrics", [this](const HttpRequest& req, HttpResponse& res) {
+        serve_cached(req, res, *cached_metrics());
+    });
+    svr.route("/stream", [](const HttpRequest&, HttpResponse& res) {
+        res.stream = true; // the server replays the latest broadcast, then pushes new ones
+    });
+    svr.route("/stream/analytics", [](const HttpRequest&, HttpResponse& res) {
+        res.stream = true;
+        res.stream_channel = "analytics";
+    });
+
+    std::thread publisher([this] { stream_publisher_loop(); });
+    std::cout << "API server (epoll) listening on http://0.0.0.0:" << port_ << "\n";
+    if (!svr.listen("0.0.0.0", port_)) {
+        std::cerr << "API server failed to bind port " << port_ << std::endl;
+    }
+    running_ = false;
+    publisher.join();
+}
+
+void ApiServer::stream_publisher_loop() {
+    using clock = std::chrono::steady_clock;
+    uint64_t last_version = 0;
+    clock::time_point next_send{};
+    while (running_.load(std::memory_order_relaxed) && engine_->is_running()) {
+        uint64_t version = engine_->wait_for_book_update(last_version, kStreamWakeInterval);
+        if (version == last_version) continue;
+        // Coalesce: hold until the window closes, then send the newest version
+        if (clock::now() < next_send) std::this_thread::sleep_until(next_send);
+        // Book and analytics bodies of the same version
+        const PublishedBook book = engine_->published();
+        last_version = book.version;
+        next_send = clock::now() + stream_coalesce_;
+        if (!book.json) continue;
+        // Built once per version and shared by reference across every stream connection
+        epoll_server_->broadcast(std::make_shared<const std::string>("data: " + *book.json + "\n\n"));
+        if (book.analytics_json) {
+            epoll_server_->broadcast(std::make_shared<const std::string>("data: " + *book.analytics_json + "\n\n"), "analytics");
+        }
+    }
+}
+
+void ApiServer::start_httplib() {
+    {
+        std::lock_guard<std::mutex> lock(server_mutex_);
+        if (stop_requested_) return;
+        server_ = std::make_unique<httplib::Server>();
+        running_ = true;
+    }
     auto& svr = *server_;
     
     // GET /orderbook - return current aggregated book snapshot as JSON
-    svr.Get("/orderbook", [this](const httplib::Request&, httplib::Response& res) {
-        res.set_content(handle_orderbook(), "application/json");
+    svr.Get("/orderbook", [this](const httplib::Request& req, httplib::Response& res) {
+        auto format = negotiate_format(req.get_param_value("format"), req.get_header_value("Accept"));
+        if (auto entry = cached_orderbook(format)) {
+            serve_cached(req, res, *entry);
+        } else {
+            res.status = 503;
+            res.set_header("Retry-After", "1");
+            res.set_content(kNotPublishedBody, kJsonContentType);
+        }
     });
     
     // GET /metrics - return performance metrics
-    svr.Get("/metrics", [this](const httplib::Request&, httplib::Response& res) {
-        res.set_content(handle_metrics(), "application/json");
+    svr.Get("/metrics", [this](const httplib::Request& req, httplib::Response& res) {
+        serve_cached(req, res, *cached_metrics());
     });
     
-    // SSE stream endpoint for continuous order book updates
-    svr.Get("/stream", [this](const httplib::Request&, httplib::Response& res) {
-        // Track connection
-        int current = connected_clients_.fetch_add(1, std::memory_order_relaxed) + 1;
-        total_connections_.fetch_add(1, std::memory_order_relaxed);
-        
-        // Update peak if current exceeds it
-        int peak = peak_connected_clients_.load(std::memory_order_relaxed);
-        while (current > peak && !peak_connected_clients_.compare_exchange_weak(peak, current, std::memory_order_relaxed)) {
-            // Retry if another thread updated peak
+    // GET /analytics - derived per-instrument numbers for the published book
+    svr.Get("/analytics", [this](const httplib::Request& req, httplib::Response& res) {
+        if (auto entry = cached_analytics()) {
+            serve_cached(req, res, *entry);
+        } else {
+            res.status = 503;
+            res.set_header("Retry-After", "1");
+            res.set_content(kNotPublishedBody, kJsonContentType);
         }
-        
-        res.set_header("Content-Type", "text/event-stream");
-        res.set_header("Cache-Control", "no-cache");
-        res.set_chunked_content_provider("text/event-stream",
-            [this](size_t /*offset*/, httplib::DataSink& sink) {
-                if (!running_.load(std::memory_order_relaxed) || !engine_->is_running()) return false;
-                // Build one SSE event
-                std::string payload = handle_orderbook();
-                std::string event = "data: " + payload + "\n\n";
-                sink.write(event.c_str(), event.size());
-                total_events_streamed_.fetch_add(1, std::memory_order_relaxed);
-                std::this_thread::sleep_for(std::chrono::milliseconds(200)); // 5 updates/sec
-                return true; // continue streaming
-            },
-            [this](bool) { // done callback
-                connected_clients_.fetch_sub(1, std::memory_order_relaxed);
-            }
-        );
     });
     
+    // SSE stream endpoints: one event per published book version (coalesced), no polling.
+    // `payload` renders the event body from the published snapshot being sent.
+    auto sse = [this](std::function<std::string(const PublishedBook&)> payload) {
+        return [this, payload](const httplib::Request&, httplib::Response& res) {
+            note_stream_open();
+
+            res.set_header("Content-Type", "text/event-stream");
+            res.set_header("Cache-Control", "no-cache");
+            using clock = std::chrono::steady_clock;
+            res.set_chunked_content_provider("text/event-stream",
+                [this, payload, last_version = uint64_t{0}, next_send = clock::time_point{}, last_write = clock::now()]
+                (size_t /*offset*/, httplib::DataSink& sink) mutable {
+                    auto alive = [this] { return running_.load(std::memory_order_relaxed) && engine_->is_running(); };
+                    if (!alive()) return false;
+                    // Block until the engine publishes a newer book version
+                    uint64_t version = engine_->wait_for_book_update(last_version, kStreamWakeInterval);
+                    if (version == last_version) {
+                        if (!alive()) return false;
+                        if (clock::now() - last_write < kStreamHeartbeat) return true;
+                        static const char heartbeat[] = ": keep-alive\n\n";
+                        last_write = clock::now();
+                        return sink.write(heartbeat, sizeof(heartbeat) - 1);
+                    }
+                    // Coalesce: hold until the window closes, then send the newest version
+                    if (clock::now() < next_send) std::this_thread::sleep_until(next_send);
+                    // Body and version from one snapshot, so the next wait starts from what was sent
+                    const PublishedBook book = engine_->published();
+                    std::string event = "data: " + payload(book) + "\n\n";
+                    if (!sink.write(event.c_str(), event.size())) return false;
+                    last_version = book.version;
+                    last_write = clock::now();
+                    next_send = last_write + stream_coalesce_;
+                    total_events_streamed_.fetch_add(1, std::memory_order_relaxed);
+                    return true; // continue streaming
+                },
+                [this](bool) { // done callback
+                    connected_clients_.fetch_sub(1, std::memory_order_relaxed);
+                }
+            );
+        };
+    };
+    svr.Get("/stream", sse([](const PublishedBook& book) {
+        return book.json ? *book.json : std::string(kNotPublishedBody);
+    }));
+    svr.Get("/stream/analytics", sse([](const PublishedBook& book) {
+        return book.analytics_json ? *book.analytics_json : std::string(kNotPublishedBody);
+    }));
+    
+    {
+        std::lock_guard<std::mutex> lock(server_mutex_);
+        if (stop_requested_) return;
+        if (!svr.bind_to_port("0.0.0.0", port_)) {
+            std::cerr << "API server failed to bind port " << port_ << std::endl;
+            return;
+        }
+        httplib_bound_ = true;
+    }
     std::cout << "API server listening on http://0.0.0.0:" << port_ << "\n";
-    svr.listen("0.0.0.0", port_);
+    svr.listen_after_bind();
+    httplib_bound_ = false;
 }
 
 void ApiServer::stop() {
-    running_ = false;
-    if (server_) server_->stop();
+    {
+        std::lock_guard<std::mutex> lock(server_mutex_);
+        stop_requested_ = true;
+        running_ = false;
+        if (epoll_server_) epoll_server_->stop();
+    }
+    // httplib drops a stop() that arrives before listen_after_bind() is running, so wait for
+    // the bound server to start (or return) rather than lose the request
+    while (httplib_bound_.load() && !server_->is_running()) std::this_thread::yield();
+    if (httplib_bound_.load()) server_->stop();
 }
@@ -0,0 +1,283 @@
+#include "../include/book_manager.h"
+#include <algorithm>
+#include "../include/depth_kernels.h"
+
+DenseIdIndex::DenseIdIndex(std::size_t expected) {
+    std::size_t cap = 16;
+    while (cap < expected * 2) cap <<= 1;
+    table_.resize(cap);
+    shift_ = 32;
+    for (std::size_t c = cap; c > 1; c >>= 1) --shift_;
+}
+
+std::uint32_t DenseIdIndex::find(std::uint32_t id) const {
+    const std::size_t mask = table_.size() - 1;
+    for (std::size_t i = bucket(id);; i = (i + 1) & mask) {
+        const Entry& e = table_[i];
+        if (e.index == kNone) return kNone;
+        if (e.id == id) return e.index;
+    }
+}
+
+std::uint32_t DenseIdIndex::insert(std::uint32_t id) {
+    if ((size_ + 1) * 2 > table_.size()) grow();
+    const std::size_t mask = table_.size() - 1;
+    for (std::size_t i = bucket(id);; i = (i + 1) & mask) {
+        Entry& e = table_[i];
+        if (e.index == kNone) {
+            e.id = id;
+            e.index = static_cast<std::uint32_t>(size_++);
+            return e.index;
+        }
+        if (e.id == id) return e.index;
+    }
+}
+
+void DenseIdIndex::grow() {
+    std::vector<Entry> old(table_.size() * 2);
+    old.swap(table_);
+    --shift_;
+    const std::size_t mask = table_.size() - 1;
+    for (const Entry& e : old) {
+        if (e.index == kNone) continue;
+        std::size_t i = bucket(e.id);
+        while (table_[i].index != kNone) i = (i + 1) & mask;
+        table_[i] = e;
+    }
+}
+
+#ifdef HFT_HAS_DATABENTO
+
+using databento::Action;
+using databento::MboMsg;
+using databento::Side;
+
+namespace {
+
+LevelSnapshot level_of(std::int64_t px, const MboBook::Level& lo) {
+    LevelSnapshot l;
+    l.price = px;
+    l.size = lo.size;
+    l.count = lo.count;
+    return l;
+}
+
+} // namespace
+
+MboBook::MboBook(std::uint16_t publisher_id, std::uint32_t index, std::pmr::memory_resource* resource,
+                 std::size_t expected_orders)
+    : publisher_id_(publisher_id), index_(index), bids_(resource), asks_(resource), by_id_(resource) {
+    if (expected_orders) by_id_.reserve(expected_orders);
+}
+
+void MboBook::Level::push(const MboMsg& o) {
+    size += o.size;
+    if (!o.flags.IsTob()) ++count;
+    orders.push_back(o);
+}
+
+void MboBook::Level::erase(std::pmr::vector<MboMsg>::iterator it) {
+    size -= it->size;
+    if (!it->flags.IsTob()) --count;
+    orders.erase(it);
+}
+
+bool MboBook::Level::totals_mismatch() const {
+    std::uint64_t sz = 0, ct = 0;
+    for (const auto& o : orders) {
+        sz += o.size;
+        if (!o.flags.IsTob()) ++ct;
+    }
+    return sz != size || ct != count;
+}
+
+MboApplyResult MboBook::apply(const MboMsg& mbo) {
+    switch (mbo.action) {
+        case Action::Clear: {
+            if (mbo.side == Side::Bid || mbo.side == Side::Ask) side_of(mbo.side).clear();
+            if (mbo.price != databento::kUndefPrice) side_of(mbo.side)[mbo.price].push(mbo);
+            return MboApplyResult::Applied;
+        }
+        case Action::Add:
+            side_of(mbo.side)[mbo.price].push(mbo);
+            by_id_.emplace(mbo.order_id, OrderRef{mbo.price, mbo.side});
+            return MboApplyResult::Applied;
+        case Action::Cancel: {
+            auto oid_it = by_id_.find(mbo.order_id);
+            if (oid_it == by_id_.end()) return MboApplyResult::OrphanCancel;
+            auto& side = side_of(oid_it->second.side);
+            auto lvl_it = side.find(oid_it->second.price);
+            if (lvl_it == side.end()) return MboApplyResult::Applied;
+            auto& lvl = lvl_it->second;
+            auto& vec = lvl.orders;
+            auto ord_it = std::find_if(vec.begin(), vec.end(), [&](const MboMsg& o) { return o.order_id == mbo.order_id; });
+            if (ord_it != vec.end()) {
+                // Partial cancels reduce the resting size; the order leaves once it reaches zero
+                lvl.resize(*ord_it, ord_it->size >= mbo.size ? ord_it->size - mbo.size : 0);
+                if (ord_it->size == 0) { lvl.erase(ord_it); by_id_.erase(oid_it); }
+                if (vec.empty()) side.erase(lvl_it);
+            }
+            return MboApplyResult::Applied;
+        }
+        case Action::Modify: {
+            auto oid_it = by_id_.find(mbo.order_id);
+            if (oid_it == by_id_.end()) { // treat as add
+                side_of(mbo.side)[mbo.price].push(mbo);
+                by_id_.emplace(mbo.order_id, OrderRef{mbo.price, mbo.side});
+                return MboApplyResult::OrphanModify;
+            }
+            auto& side_old = side_of(oid_it->second.side);
+            auto lvl_old_it = side_old.find(oid_it->second.price);
+            if (lvl_old_it == side_old.end()) return MboApplyResult::Applied;
+            auto& lvl_old = lvl_old_it->second;
+            auto& vec = lvl_old.orders;
+            auto ord_it = std::find_if(vec.begin(), vec.end(), [&](const MboMsg& o) { return o.order_id == mbo.order_id; });
+            if (ord_it == vec.end()) return MboApplyResult::Applied;
+            if (oid_it->second.price != mbo.price) { // price change => remove then reinsert losing priority
+                MboMsg moved = *ord_it;
+                lvl_old.erase(ord_it);
+                moved.price = mbo.price;
+                moved.size = mbo.size;
+                side_of(mbo.side)[mbo.price].push(moved);
+                if (vec.empty()) side_old.erase(lvl_old_it);
+                oid_it->second.price = mbo.price;
+                oid_it->second.side = mbo.side;
+            } else if (ord_it->size < mbo.size) { // size increase at the same price loses priority
+                lvl_old.resize(*ord_it, mbo.size);
+                MboMsg temp = *ord_it;
+                vec.erase(ord_it);
+                vec.push_back(temp);
+            } else {
+                lvl_old.resize(*ord_it, mbo.size);
+            }
+            return MboApplyResult::Applied;
+        }
+        case Action::Trade: case Action::Fill: case Action::None:
+            return MboApplyResult::Applied; // no resting-book effect
+        default:
+            return MboApplyResult::UnknownAction;
+    }
+}
+
+void MboBook::top_levels(std::size_t depth, std::vector<LevelSnapshot>& bids, std::vector<LevelSnapshot>& asks) const {
+    bids.clear();
+    asks.clear();
+    for (auto rit = bids_.rbegin(); rit != bids_.rend() && bids.size() < depth; ++rit) bids.push_back(level_of(rit->first, rit->second));
+    for (auto it = asks_.begin(); it != asks_.end() && asks.size() < depth; ++it) asks.push_back(level_of(it->first, it->second));
+}
+
+std::uint64_t MboBook::snapshot(PublisherSnapshot& out, bool recount) const {
+    out.publisher_id = publisher_id_;
+    out.bids.reserve(bids_.size());
+    out.asks.reserve(asks_.size());
+    for (auto rit = bids_.rbegin(); rit != bids_.rend(); ++rit) out.bids.push_back(level_of(rit->first, rit->second));
+    for (auto it = asks_.begin(); it != asks_.end(); ++it) out.asks.push_back(level_of(it->first, it->second));
+    if (!out.bids.empty()) out.best_bid = out.bids.front();
+    if (!out.asks.empty()) out.best_ask = out.asks.front();
+    std::uint64_t mismatches = 0;
+    if (recount) {
+        for (const auto& kv : bids_) mismatches += kv.second.totals_mismatch();
+        for (const auto& kv : asks_) mismatches += kv.second.totals_mismatch();
+    }
+    return mismatches;
+}
+
+namespace {
+
+// Order vectors up to ~1100 orders stay pooled; deeper levels go straight to the upstream heap
+std::pmr::pool_options book_pool_options() {
+    std::pmr::pool_options options;
+    options.largest_required_pool_block = std::size_t{64} << 10;
+    return options;
+}
+
+} // namespace
+
+BookManager::BookManager(std::size_t expected_instruments, std::size_t expected_orders_per_book)
+    : pool_(std::make_unique<std::pmr::unsynchronized_pool_resource>(book_pool_options())),
+      index_(expected_instruments),
+      expected_orders_per_book_(expected_orders_per_book) {
+    instruments_.reserve(expected_instruments);
+}
+
+std::uint32_t BookManager::instrument_slot(std::uint32_t instrument_id) {
+    if (last_slot_ != kNone && last_instrument_id_ == instrument_id) return last_slot_;
+    const std::uint32_t slot = index_.insert(instrument_id);
+    if (slot == instruments_.size()) {
+        instruments_.emplace_back();
+        instruments_.back().instrument_id = instrument_id;
+    }
+    last_instrument_id_ = instrument_id;
+    last_slot_ = slot;
+    return slot;
+}
+
+std::uint32_t BookManager::publisher_slot(std::uint16_t publisher_id) {
+    if (publisher_id >= publisher_index_.size()) publisher_index_.resize(std::size_t{publisher_id} + 1, kNone);
+    std::uint32_t& slot = publisher_index_[publisher_id];
+    if (slot == kNone) {
+        slot = static_cast<std::uint32_t>(publisher_ids_.size());
+        publisher_ids_.push_back(publisher_id);
+    }
+    return slot;
+}
+
+BookManager::Instrument& BookManager::instrument(std::uint32_t instrument_id) {
+    return instruments_[instrument_slot(instrument_id)];
+}
+
+MboBook& BookManager::route(std::uint32_t instrument_id, std::uint16_t publisher_id) {
+    Instrument& inst = instrument(instrument_id);
+    const std::uint32_t pub = publisher_slot(publisher_id);
+    if (pub >= inst.book_of.size()) inst.book_of.resize(std::size_t{pub} + 1, kNone);
+    std::uint32_t& pos = inst.book_of[pub];
+    if (pos == kNone) {
+        pos = static_cast<std::uint32_t>(inst.books.size());
+        inst.books.emplace_back(publisher_id, book_count_++, pool_.get(), expected_orders_per_book_);
+    }
+    return inst.books[pos];
+}
+
+MboApplyResult BookManager::apply(const MboMsg& mbo, std::uint64_t seq, const MboBook** applied_to) {
+    MboBook& book = route(mbo.hd.instrument_id, mbo.hd.publisher_id);
+    instruments_[last_slot_].seq = seq; // route() left the record's instrument cached
+    if (applied_to) *applied_to = &book;
+    return book.apply(mbo);
+}
+
+const BookManager::Instrument* BookManager::find(std::uint32_t instrument_id) const {
+    const std::uint32_t slot = index_.find(instrument_id);
+    return slot == kNone ? nullptr : &instruments_[slot];
+}
+
+const MboBook* BookManager::find(std::uint32_t instrument_id, std::uint16_t publisher_id) const {
+    const Instrument* inst = find(instrument_id);
+    const std::uint32_t pub = publisher_index(publisher_id);
+    if (!inst || pub >= inst->book_of.size() || inst->book_of[pub] == kNone) return nullptr;
+    return &inst->books[inst->book_of[pub]];
+}
+
+void BookManager::snapshot(BookSnapshot& out, bool recount) const {
+    out.instruments.reserve(instruments_.size());
+    DepthColumns bbo_bid, bbo_ask;
+    for (const auto& inst : instruments_) {
+        InstrumentSnapshot is;
+        is.instrument_id = inst.instrument_id;
+        is.seq = inst.seq;
+        is.publishers.resize(inst.books.size());
+        for (std::size_t i = 0; i < inst.books.size(); ++i) {
+            out.level_total_mismatches += inst.books[i].snapshot(is.publishers[i], recount);
+        }
+        // Aggregated BBO: gather publisher tops into columns and reduce across them
+        bbo_bid.clear(); bbo_ask.clear();
+        for (const auto& ps : is.publishers) {
+            bbo_bid.push(ps.best_bid.price, ps.best_bid.size, ps.best_bid.count);
+            bbo_ask.push(ps.best_ask.price, ps.best_ask.size, ps.best_ask.count);
+        }
+        is.agg_bid = depth::best_across(bbo_bid.price.data(), bbo_bid.size.data(), bbo_bid.count.data(), bbo_bid.levels(), true);
+        is.agg_ask = depth::best_across(bbo_ask.price.data(), bbo_ask.size.data(), bbo_ask.count.data(), bbo_ask.levels(), false);
+        out.instruments.push_back(std::move(is));
+    }
+}
+
+#endif // HFT_HAS_DATABENTO
@@ -0,0 +1,283 @@
+#include "../include/depth_kernels.h"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define HFT_DEPTH_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace depth {
+namespace {
+
+// ---------------------------------------------------------------- scalar
+
+void cumulative_scalar(const std::uint32_t* size, std::size_t n, std::uint64_t* out) {
+    std::uint64_t acc = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        acc += size[i];
+        out[i] = acc;
+    }
+}
+
+std::uint64_t total_scalar(const std::uint32_t* size, std::size_t n) {
+    std::uint64_t acc = 0;
+    for (std::size_t i = 0; i < n; ++i) acc += size[i];
+    return acc;
+}
+
+double dot_scalar(const std::int64_t* price, const std::uint32_t* size, std::size_t n) {
+    double acc = 0.0;
+    for (std::size_t i = 0; i < n; ++i) acc += static_cast<double>(price[i]) * size[i];
+    return acc;
+}
+
+// Index of the first level whose cumulative size reaches target (n if never)
+std::size_t reach_scalar(const std::uint32_t* size, std::size_t n, std::uint64_t target, std::uint64_t* before) {
+    std::uint64_t acc = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        if (acc + size[i] >= target) { *before = acc; return i; }
+        acc += size[i];
+    }
+    *before = acc;
+    return n;
+}
+
+// Scalar only: best_across scans one candidate per publisher, usually fewer than a couple of
+// AVX2 vectors' worth, so a vector path would almost never run
+std::size_t best_index(const std::int64_t* price, std::size_t n, bool highest) {
+    std::size_t best = n;
+    for (std::size_t i = 0; i < n; ++i) {
+        if (price[i] == kSnapshotUndefPrice) continue;
+        if (best == n || (highest ? price[i] > price[best] : price[i] < price[best])) best = i;
+    }
+    return best;
+}
+
+#ifdef HFT_DEPTH_AVX2
+// ---------------------------------------------------------------- AVX2
+
+__attribute__((target("avx2"))) inline __m256i load_u32x4_as_u64(const std::uint32_t* p) {
+    return _mm256_cvtepu32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+}
+
+// In-register inclusive scan of four 64-bit lanes
+__attribute__((target("avx2"))) inline __m256i scan4(__m256i x) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i s1 = _mm256_blend_epi32(_mm256_permute4x64_epi64(x, _MM_SHUFFLE(2, 1, 0, 0)), zero, 0x03);
+    x = _mm256_add_epi64(x, s1);
+    __m256i s2 = _mm256_blend_epi32(_mm256_permute4x64_epi64(x, _MM_SHUFFLE(1, 0, 0, 0)), zero, 0x0F);
+    return _mm256_add_epi64(x, s2);
+}
+
+__attribute__((target("avx2"))) void cumulative_avx2(const std::uint32_t* size, std::size_t n, std::uint64_t* out) {
+    __m256i carry = _mm256_setzero_si256();
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i v = _mm256_add_epi64(scan4(load_u32x4_as_u64(size + i)), carry);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), v);
+        carry = _mm256_permute4x64_epi64(v, _MM_SHUFFLE(3, 3, 3, 3));
+    }
+    std::uint64_t acc = i ? out[i - 1] : 0;
+    for (; i < n; ++i) {
+        acc += size[i];
+        out[i] = acc;
+    }
+}
+
+__attribute__((target("avx2"))) std::uint64_t total_avx2(const std::uint32_t* size, std::size_t n) {
+    __m256i acc = _mm256_setzero_si256();
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) acc = _mm256_add_epi64(acc, load_u32x4_as_u64(size + i));
+    alignas(32) std::uint64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), acc);
+    std::uint64_t sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    for (; i < n; ++i) sum += size[i];
+    return sum;
+}
+
+// int64 -> double, exact only for |x| < 2^51 (about $2.25M in 1e-9 price units); callers
+// check the range with in_i64_to_pd_range first
+__attribute__((target("avx2"))) inline __m256d i64_to_pd(__m256i x) {
+    const __m256i magic_i = _mm256_set1_epi64x(0x4338000000000000LL);
+    const __m256d magic_d = _mm256_set1_pd(6755399441055744.0); // 2^52 + 2^51
+    return _mm256_sub_pd(_mm256_castsi256_pd(_mm256_add_epi64(x, magic_i)), magic_d);
+}
+
+// True when every lane is in (-2^51, 2^51): x + 2^51 then fits in 52 unsigned bits
+__attribute__((target("avx2"))) inline bool in_i64_to_pd_range(__m256i x) {
+    const __m256i biased = _mm256_add_epi64(x, _mm256_set1_epi64x(std::int64_t{1} << 51));
+    const __m256i high = _mm256_srli_epi64(biased, 52);
+    return _mm256_testz_si256(high, high);
+}
+
+__attribute__((target("avx2"))) double dot_avx2(const std::int64_t* price, const std::uint32_t* size, std::size_t n) {
+    __m256d acc = _mm256_setzero_pd();
+    double sum = 0.0;
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i raw = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(price + i));
+        if (!in_i64_to_pd_range(raw)) { // out-of-range prices take the exact scalar conversion
+            sum += dot_scalar(price + i, size + i, 4);
+            continue;
+        }
+        __m256d px = i64_to_pd(raw);
+        __m256d sz = i64_to_pd(load_u32x4_as_u64(size + i)); // zero-extended: sizes >= 2^31 stay positive
+        acc = _mm256_add_pd(acc, _mm256_mul_pd(px, sz));
+    }
+    alignas(32) double lanes[4];
+    _mm256_store_pd(lanes, acc);
+    sum += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    for (; i < n; ++i) sum += static_cast<double>(price[i]) * size[i];
+    return sum;
+}
+
+__attribute__((target("avx2"))) std::size_t reach_avx2(const std::uint32_t* size, std::size_t n, std::uint64_t target,
+                                                       std::uint64_t* before) {
+    // Compare four running totals at once against target (values stay < 2^63, so signed compare is safe)
+    const __m256i tgt = _mm256_set1_epi64x(static_cast<long long>(target - 1));
+    __m256i carry = _mm256_setzero_si256();
+    std::size_t i = 0;
+    std::uint64_t acc = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i v = _mm256_add_epi64(scan4(load_u32x4_as_u64(size + i)), carry);
+        int mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(v, tgt)));
+        if (mask) {
+            std::size_t k = reach_scalar(size + i, 4, target - acc, before);
+            *before += acc;
+            return i + k;
+        }
+        carry = _mm256_permute4x64_epi64(v, _MM_SHUFFLE(3, 3, 3, 3));
+        acc = static_cast<std::uint64_t>(_mm256_extract_epi64(v, 3));
+    }
+    std::size_t k = reach_scalar(size + i, n - i, target - acc, before);
+    *before += acc;
+    return i + k;
+}
+#endif // HFT_DEPTH_AVX2
+
+// ---------------------------------------------------------------- dispatch
+
+struct Kernels {
+    void (*cumulative)(const std::uint32_t*, std::size_t, std::uint64_t*);
+    std::uint64_t (*total)(const std::uint32_t*, std::size_t);
+    double (*dot)(const std::int64_t*, const std::uint32_t*, std::size_t);
+    std::size_t (*reach)(const std::uint32_t*, std::size_t, std::uint64_t, std::uint64_t*);
+    const char* isa;
+};
+
+#ifdef HFT_DEPTH_AVX2
+// Runs both kernel sets over the same pseudo-random columns (sizes across the full uint32
+// range, prices inside and outside the exact-conversion range, undefined prices, every
+// length up to a few vectors). Integer kernels must agree exactly, dot to rounding.
+bool kernels_agree(const Kernels& a, const Kernels& b) {
+    std::uint64_t state = 0x9E3779B97F4A7C15ull; // fixed seed: the check is deterministic
+    auto next = [&state] {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    };
+    constexpr std::size_t kMaxLevels = 37;
+    std::int64_t price[kMaxLevels];
+    std::uint32_t size[kMaxLevels];
+    std::uint64_t cum_a[kMaxLevels], cum_b[kMaxLevels];
+    for (int round = 0; round < 64; ++round) {
+        for (std::size_t i = 0; i < kMaxLevels; ++i) {
+            const std::uint64_t r = next();
+            switch (r % 8) {
+                case 0: price[i] = kSnapshotUndefPrice; break;
+                case 1: price[i] = static_cast<std::int64_t>(next() >> 2) - (std::int64_t{1} << 61); break; // beyond 2^51
+                default: price[i] = static_cast<std::int64_t>(next() % 200000000000ull) - 100000000000ll; break;
+            }
+            size[i] = (r >> 8) % 4 == 0 ? static_cast<std::uint32_t>(next() | 0x80000000u) : static_cast<std::uint32_t>(next() % 1000);
+        }
+        for (std::size_t n = 0; n <= kMaxLevels; ++n) {
+            a.cumulative(size, n, cum_a);
+            b.cumulative(size, n, cum_b);
+            if (n && std::memcmp(cum_a, cum_b, n * sizeof(cum_a[0])) != 0) return false;
+            if (a.total(size, n) != b.total(size, n)) return false;
+            const std::uint64_t target = 1 + next() % (b.total(size, n) + 2);
+            std::uint64_t before_a = 0, before_b = 0;
+            if (a.reach(size, n, target, &before_a) != b.reach(size, n, target, &before_b) || before_a != before_b) return false;
+            double magnitude = 0.0; // sum of |terms| bounds the rounding difference
+            for (std::size_t i = 0; i < n; ++i) {
+                if (price[i] == kSnapshotUndefPrice) continue;
+                magnitude += std::fabs(static_cast<double>(price[i])) * size[i];
+            }
+            // dot is only fed defined prices; mask undefined ones to 0 for the comparison
+            std::int64_t defined[kMaxLevels];
+            for (std::size_t i = 0; i < n; ++i) defined[i] = price[i] == kSnapshotUndefPrice ? 0 : price[i];
+            if (std::fabs(a.dot(defined, size, n) - b.dot(defined, size, n)) > magnitude * 1e-12) return false;
+        }
+    }
+    return true;
+}
+#endif
+
+Kernels select_kernels() {
+    Kernels k{cumulative_scalar, total_scalar, dot_scalar, reach_scalar, "scalar"};
+#ifdef HFT_DEPTH_AVX2
+    const char* off = std::getenv("HFT_DISABLE_SIMD");
+    if (!(off && std::strcmp(off, "1") == 0) && __builtin_cpu_supports("avx2")) {
+        const Kernels avx2{cumulative_avx2, total_avx2, dot_avx2, reach_avx2, "avx2"};
+        // Startup parity check against the scalar reference; a mismatch keeps the scalar path
+        if (kernels_agree(avx2, k)) {
+            k = avx2;
+        } else {
+            k.isa = "scalar (avx2 parity check failed)";
+        }
+    }
+#endif
+    return k;
+}
+
+const Kernels& kernels() {
+    static const Kernels k = select_kernels();
+    return k;
+}
+
+} // namespace
+
+void cumulative(const std::uint32_t* size, std::size_t n, std::uint64_t* out) { kernels().cumulative(size, n, out); }
+
+std::uint64_t total(const std::uint32_t* size, std::size_t n) { return kernels().total(size, n); }
+
+VwapFill vwap_to_size(const std::int64_t* price, const std::uint32_t* size, std::size_t n, std::uint64_t target) {
+    VwapFill f;
+    if (n == 0 || target == 0) return f;
+    const Kernels& k = kernels();
+    std::uint64_t before = 0;
+    std::size_t idx = k.reach(size, n, target, &before);
+    // Whole levels [0, idx) plus the remainder from level idx
+    f.notional = k.dot(price, size, idx);
+    f.filled = before;
+    f.levels_used = idx;
+    if (idx < n) {
+        std::uint64_t rest = target - before;
+        f.notional += static_cast<double>(price[idx]) * static_cast<double>(rest);
+        f.filled += rest;
+        f.levels_used = idx + 1;
+    }
+    f.vwap = f.filled ? f.notional / static_cast<double>(f.filled) : 0.0;
+    return f;
+}
+
+LevelSnapshot best_across(const std::int64_t* price, const std::uint32_t* size, const std::uint32_t* count,
+                          std::size_t n, bool highest) {
+    LevelSnapshot out;
+    std::size_t b = best_index(price, n, highest);
+    if (b >= n) return out;
+    out.price = price[b];
+    for (std::size_t i = b; i < n; ++i) {
+        if (price[i] != out.price) continue;
+        out.size += size[i];
+        out.count += count[i];
+    }
+    return out;
+}
+
+const char* active_isa() { return kernels().isa; }
+
+} // namespace depth
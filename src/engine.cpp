@@ -5,9 +5,9 @@
 #include <chrono>
 #include <sstream>
 #include <vector>
-#include <map>
-#include <unordered_map>
 #include <algorithm>
+#include "../include/book_manager.h"
+#include "../include/alloc_counter.h"
 #ifdef HFT_HAS_DATABENTO
 #include <databento/exceptions.hpp>
 #endif
@@ -16,60 +16,112 @@
 // Initial phase: provide raw MBO JSON dump to verify file decoding before
 // constructing an order book.
 
-Engine::Engine(std::string dbn_path) : dbn_path_(std::move(dbn_path)) {}
+#ifdef HFT_HAS_DATABENTO
+namespace {
+
+// Applies records of a growing DBN file as they land. caught_up() fires the first time the
+// reader reaches the end of the file; publish() is held until then (a mid-catch-up version
+// would only cost a full snapshot rebuild) and afterwards runs at most every publish_interval
+// while unpublished records exist. Returns when running clears.
+template <class Apply, class Publish, class CaughtUp>
+void follow_dbn(const std::string& path, const FollowOptions& options, const std::atomic<bool>& running,
+                Apply&& apply, Publish&& publish, CaughtUp&& caught_up) {
+    using clock = std::chrono::steady_clock;
+    DbnTailReader tail(path, options.poll_interval);
+    bool dirty = false, first_catch_up = true;
+    clock::time_point next_publish{};
+    while (running.load(std::memory_order_relaxed)) {
+        while (const databento::MboMsg* mbo = tail.next()) {
+            apply(*mbo);
+            dirty = true;
+        }
+        const bool more = tail.refill() > 0;
+        if (!more && first_catch_up) {
+            first_catch_up = false;
+            caught_up();
+        }
+        const auto now = clock::now();
+        if (dirty && !first_catch_up && now >= next_publish) {
+            publish();
+            dirty = false;
+            next_publish = now + options.publish_interval;
+        }
+        if (more) continue;
+        auto timeout = dirty ? std::chrono::duration_cast<std::chrono::milliseconds>(next_publish - now) : options.poll_interval;
+        tail.wait(std::max(timeout, std::chrono::milliseconds(1)));
+    }
+}
+
+} // namespace
+#endif
+
+Engine::Engine(std::string dbn_path) {
+    if (!dbn_path.empty()) dbn_paths_.push_back(std::move(dbn_path));
+}
 
 void Engine::init() {
     // Currently nothing special to init besides constructing OrderBook.
 }
 
 #ifdef HFT_HAS_DATABENTO
-DBNRecord Engine::map_mbo(const databento::MboMsg& mbo) const {
-    DBNRecord r;
-    r.order_id = mbo.order_id;
-    r.price = mbo.price; // price is already integer (likely in nanounits)
-    r.size = static_cast<std::int32_t>(mbo.size);
-    r.side = (mbo.side == databento::Side::Bid) ? 'B' : 'A';
+void Engine::apply_mbo(const databento::MboMsg& mbo) {
+    const BookSide side = (mbo.side == databento::Side::Bid) ? BookSide::Bid : BookSide::Ask;
+    const auto size = static_cast<std::int32_t>(mbo.size);
     switch (mbo.action) {
-        case databento::Action::Add: r.action = 'A'; break;
-        case databento::Action::Modify: r.action = 'M'; break;
-        case databento::Action::Cancel: r.action = 'C'; break;
-        case databento::Action::Trade: // Trade implies a fill for an existing order
-        case databento::Action::Fill: r.action = 'F'; break;
-        default: r.action = 'U'; break;
+        case databento::Action::Add: book_.add_order(mbo.order_id, mbo.price, size, side); break; // price is already integer (nanounits)
+        case databento::Action::Modify:
+            if (!book_.modify_order(mbo.order_id, mbo.price, size)) metrics_.orphan_modifies.fetch_add(1, std::memory_order_relaxed);
+            break;
+        case databento::Action::Cancel:
+            if (!book_.cancel_order(mbo.order_id)) metrics_.orphan_cancels.fetch_add(1, std::memory_order_relaxed);
+            break;
+        case databento::Action::Trade: break; // a trade print does not change the book; its fills do
+        case databento::Action::Fill:
+            if (!book_.fill_order(mbo.order_id)) metrics_.orphan_fills.fetch_add(1, std::memory_order_relaxed);
+            break;
+        default: metrics_.unknown_actions.fetch_add(1, std::memory_order_relaxed); break;
     }
-    return r;
 }
 #endif
 
+OrderBookChange Engine::apply_update(const DBNRecord& record) {
+    const std::uint64_t modifies = book_.orphan_modifies(), cancels = book_.orphan_cancels(),
+                        fills = book_.orphan_fills(), unknown = book_.unknown_actions();
+    OrderBookChange change = book_.apply_update(record);
+    metrics_.orphan_modifies.fetch_add(book_.orphan_modifies() - modifies, std::memory_order_relaxed);
+    metrics_.orphan_cancels.fetch_add(book_.orphan_cancels() - cancels, std::memory_order_relaxed);
+    metrics_.orphan_fills.fetch_add(book_.orphan_fills() - fills, std::memory_order_relaxed);
+    metrics_.unknown_actions.fetch_add(book_.unknown_actions() - unknown, std::memory_order_relaxed);
+    return change;
+}
+
 void Engine::replay(const AsyncLogger& logger, std::size_t max_snapshots) {
 #ifndef HFT_HAS_DATABENTO
     logger.log("Databento headers not available. Replay disabled.");
     return;
 #else
-    if (dbn_path_.empty()) {
+    if (dbn_paths_.empty()) {
         logger.log("No DBN file path set.");
         return;
     }
-    logger.log(std::string("Replaying file for order book construction: ") + dbn_path_);
+    logger.log("Replaying " + std::to_string(dbn_paths_.size()) + " file(s) for order book construction, first: " + dbn_paths_.front());
     try {
-        // Use upgrade policy so version 3 DBN can be decoded by v2 decoder.
-        databento::DbnFileStore store(nullptr, dbn_path_, databento::VersionUpgradePolicy::UpgradeToV2);
+        // Inputs are opened with the v2 upgrade policy so version 3 DBN can be decoded by the v2 decoder.
+        MergedMboReader reader(dbn_paths_);
         std::size_t snapshot_count = 0;
-        store.Replay([&](const databento::Record& rec){
-            if (!running_.load(std::memory_order_relaxed)) {
-                return databento::Stop;
-            }
-            if (rec.Holds<databento::MboMsg>()) {
-                const auto& mbo = rec.Get<databento::MboMsg>();
-                DBNRecord r = map_mbo(mbo);
-                book_.apply_update(r);
-                if (++snapshot_count >= max_snapshots) {
-                    return databento::Stop;
-                }
-            }
-            return databento::Continue;
-        });
+        while (const databento::MboMsg* mbo = reader.next()) {
+            if (!running_.load(std::memory_order_relaxed)) break;
+            apply_mbo(*mbo);
+            if (++snapshot_count >= max_snapshots) break;
+        }
         logger.log("Replay finished; applied " + std::to_string(snapshot_count) + " MBO messages to book.");
+        const AuditReport audit = book_.audit();
+        metrics_.audits_run.fetch_add(1, std::memory_order_relaxed);
+        if (!audit.clean()) {
+            metrics_.audits_failed.fetch_add(1, std::memory_order_relaxed);
+            logger.log("Book audit failed: " + std::to_string(audit.level_total_mismatches) + " level total mismatches, " +
+                       std::to_string(audit.crossed_books) + " crossed");
+        }
     } catch (const databento::DbnResponseError& e) {
         metrics_.replay_errors.fetch_add(1, std::memory_order_relaxed);
         metrics_.set_last_error(e.what());
@@ -83,182 +135,246 @@ void Engine::replay(const AsyncLogger& logger, std::size_t max_snapshots) {
 }
 
 std::string Engine::reconstruct_orderbook_json(std::size_t levels) const {
+    return snapshot_to_json(reconstruct_snapshot(), levels);
+}
+
+BookSnapshot Engine::reconstruct_snapshot(BookSampler* sampler, MbpFeedWriter* mbp) const {
+    BookSnapshot snap;
 #ifndef HFT_HAS_DATABENTO
-    return "{\"error\": \"Databento headers not available\"}";
+    snap.error = "{\"error\": \"Databento headers not available\"}";
+    return snap;
 #else
-    if (dbn_path_.empty()) return "{\"error\": \"No DBN path provided\"}";
+    if (dbn_paths_.empty()) { snap.error = "{\"error\": \"No DBN path provided\"}"; return snap; }
+    // Only one follower per engine: a second one would tail the file again and publish as a second writer
+    if (follow_.enabled && following_.exchange(true, std::memory_order_acq_rel)) {
+        snap.error = "{\"error\": \"already following the input\"}";
+        return snap;
+    }
     using namespace databento;
-    struct OrderRef { int64_t price; Side side; };
-    struct LevelOrders { std::vector<MboMsg> orders; };
-    struct BookSide { std::map<int64_t, LevelOrders> levels; };
-    struct PublisherBook { uint16_t publisher_id; BookSide bids; BookSide asks; std::unordered_map<uint64_t, OrderRef> by_id; };
-    struct Instrument { 
-        uint32_t instrument_id; 
-        std::vector<PublisherBook> pub_books; 
-        Instrument() { pub_books.reserve(4); } // pre-reserve typical publisher count
-    };
-    std::unordered_map<uint32_t, Instrument> instruments; 
+    BookManager books;
     UnixNanos last_ts_recv{}; size_t mbo_count=0;
+    // Sampler stage: top-N of every publisher book, reusing scratch rows (no per-sample allocation)
+    std::vector<LevelSnapshot> bid_rows, ask_rows;
+    if (sampler) { bid_rows.reserve(sampler->depth()); ask_rows.reserve(sampler->depth()); }
     
+    // Ingest allocations are counted from the end of one record to the end of the next, so the
+    // window covers reading/decoding it (including the merge's decoder threads), applying it
+    // and the MBP writer. Sampling (CSV formatting and file writes) and publishing are not
+    // ingest: they move the mark past their own allocations.
+    const MergedMboReader* merged = nullptr;
+    auto ingest_allocation_count = [&] {
+        return alloc_counter::thread_allocations() + (merged ? merged->decoder_allocations() : 0);
+    };
+    uint64_t alloc_mark = 0;
+
+    auto sample_books = [&](uint64_t ts) {
+        const uint64_t before = alloc_counter::kEnabled ? alloc_counter::thread_allocations() : 0;
+        books.for_each_book([&](const BookManager::Instrument& inst, const MboBook& book) {
+            book.top_levels(sampler->depth(), bid_rows, ask_rows);
+            sampler->write_row(ts, inst.instrument_id, book.publisher_id(), bid_rows.data(), bid_rows.size(), ask_rows.data(), ask_rows.size());
+        });
+        if (alloc_counter::kEnabled) alloc_mark += alloc_counter::thread_allocations() - before;
+    };
+
+    auto apply_record = [&](const MboMsg& mbo) {
+        const uint64_t ts_recv_ns = mbo.ts_recv.time_since_epoch().count();
+        if (sampler && sampler->due_before(ts_recv_ns)) sample_books(sampler->sample_ts());
+        
+        // Measure per-message processing latency
+        auto start = std::chrono::high_resolution_clock::now();
+        
+        last_ts_recv = mbo.ts_recv; ++mbo_count;
+        // seq = mbo_count lets analytics skip instruments that did not change
+        const MboBook* book = nullptr;
+        switch (books.apply(mbo, mbo_count, &book)) {
+            case MboApplyResult::Applied: break;
+            case MboApplyResult::OrphanCancel: metrics_.orphan_cancels.fetch_add(1, std::memory_order_relaxed); break;
+            case MboApplyResult::OrphanModify: metrics_.orphan_modifies.fetch_add(1, std::memory_order_relaxed); break;
+            case MboApplyResult::UnknownAction: metrics_.unknown_actions.fetch_add(1, std::memory_order_relaxed); break;
+        }
+        
+        // Record latency after processing
+        auto end = std::chrono::high_resolution_clock::now();
+        auto latency_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        metrics_.record_latency(latency_ns);
+        metrics_.total_messages.fetch_add(1, std::memory_order_relaxed);
+        if (sampler && sampler->due_after()) sample_books(ts_recv_ns);
+        if (mbp) mbp->on_update(mbo, *book);
+        if (alloc_counter::kEnabled) {
+            const uint64_t allocs = ingest_allocation_count();
+            if (mbo_count > alloc_warmup_messages_) {
+                metrics_.ingest_allocations.fetch_add(allocs - alloc_mark, std::memory_order_relaxed);
+                metrics_.ingest_alloc_messages.fetch_add(1, std::memory_order_relaxed);
+            }
+            alloc_mark = allocs;
+        }
+    };
+    // Copy the books into a format-neutral snapshot (all levels, best first per side).
+    // Sampled audit: when the verifier asked for it, every level is also recounted from its orders
+    auto build_snapshot = [&](BookSnapshot& out) {
+        out.level_totals_audited = level_recount_requested_.exchange(false, std::memory_order_relaxed);
+        out.last_ts_recv = last_ts_recv.time_since_epoch().count();
+        out.last_ts_recv_iso = databento::ToIso8601(last_ts_recv);
+        out.mbo_count = mbo_count;
+        books.snapshot(out, out.level_totals_audited);
+    };
+
     auto replay_start = std::chrono::high_resolution_clock::now();
     
     try {
-        DbnFileStore store(nullptr, dbn_path_, VersionUpgradePolicy::UpgradeToV2);
-        store.Replay([&](const Record& rec){
-            if (!rec.Holds<MboMsg>()) return databento::Continue;
-            const auto& mbo = rec.Get<MboMsg>();
-            if (!running_.load(std::memory_order_relaxed)) {
-                return databento::Stop;
+        if (follow_.enabled) {
+            if (dbn_paths_.size() > 1) metrics_.set_last_error("follow mode tails only the first input");
+            follow_dbn(dbn_paths_.front(), follow_, running_, apply_record,
+                       [&] {
+                           auto live = std::make_shared<BookSnapshot>();
+                           build_snapshot(*live);
+                           publish_snapshot(std::move(live));
+                           if (mbp) { // downstream readers of the feed see records as versions publish
+                               mbp->flush();
+                               metrics_.mbp_records.store(mbp->records_written(), std::memory_order_relaxed);
+                           }
+                           alloc_mark = ingest_allocation_count();
+                       },
+                       [&] { // throughput covers the catch-up read, not time spent waiting for appends
+                           metrics_.replay_duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                               std::chrono::high_resolution_clock::now() - replay_start).count();
+                       });
+        } else {
+            // One file is decoded inline; several are decoded in parallel and merged by ts_recv
+            MergedMboReader reader(dbn_paths_);
+            merged = &reader;
+            while (const MboMsg* next = reader.next()) {
+                if (!running_.load(std::memory_order_relaxed)) break;
+                apply_record(*next);
             }
-            
-            // Measure per-message processing latency
-            auto start = std::chrono::high_resolution_clock::now();
-            
-            last_ts_recv = mbo.ts_recv; ++mbo_count;
-            auto& inst = instruments[mbo.hd.instrument_id];
-            inst.instrument_id = mbo.hd.instrument_id;
-                // Find publisher book
-                auto pub_it = std::find_if(inst.pub_books.begin(), inst.pub_books.end(), [&](const PublisherBook& pb){return pb.publisher_id==mbo.hd.publisher_id;});
-                if (pub_it==inst.pub_books.end()) { inst.pub_books.push_back(PublisherBook{mbo.hd.publisher_id,{},{},{}}); pub_it = std::prev(inst.pub_books.end()); }
-                PublisherBook& pb = *pub_it;
-                // Handle actions
-                switch (mbo.action) {
-                    case Action::Clear: {
-                        if (mbo.side==Side::Bid) { pb.bids.levels.clear(); } else if (mbo.side==Side::Ask){ pb.asks.levels.clear(); }
-                        if (mbo.price!=kUndefPrice) {
-                            auto& side = (mbo.side==Side::Bid)? pb.bids : pb.asks;
-                            side.levels[mbo.price].orders.push_back(mbo);
-                        }
-                        break; }
-                    case Action::Add: {
-                        auto& side = (mbo.side==Side::Bid)? pb.bids : pb.asks;
-                        side.levels[mbo.price].orders.push_back(mbo);
-                        pb.by_id.emplace(mbo.order_id, OrderRef{mbo.price,mbo.side});
-                        break; }
-                    case Action::Cancel: {
-                        auto oid_it = pb.by_id.find(mbo.order_id); if (oid_it==pb.by_id.end()) break; // ignore unknown
-                        auto& side = (oid_it->second.side==Side::Bid)? pb.bids : pb.asks;
-                        auto lvl_it = side.levels.find(oid_it->second.price); if (lvl_it==side.levels.end()) break;
-                        // find order
-                        auto& vec = lvl_it->second.orders;
-                        auto ord_it = std::find_if(vec.begin(), vec.end(), [&](const MboMsg& o){return o.order_id==mbo.order_id;});
-                        if (ord_it!=vec.end()) {
-                            if (ord_it->size >= mbo.size) ord_it->size -= mbo.size; else ord_it->size=0;
-                            if (ord_it->size==0) { vec.erase(ord_it); pb.by_id.erase(oid_it); }
-                            if (vec.empty()) side.levels.erase(lvl_it);
-                        }
-                        break; }
-                    case Action::Modify: {
-                        auto oid_it = pb.by_id.find(mbo.order_id); if (oid_it==pb.by_id.end()) { // treat as add
-                            auto& side = (mbo.side==Side::Bid)? pb.bids : pb.asks;
-                            side.levels[mbo.price].orders.push_back(mbo);
-                            pb.by_id.emplace(mbo.order_id, OrderRef{mbo.price,mbo.side});
-                            break; }
-                        // existing order
-                        auto& side_old = (oid_it->second.side==Side::Bid)? pb.bids : pb.asks;
-                        auto lvl_old_it = side_old.levels.find(oid_it->second.price); if (lvl_old_it!=side_old.levels.end()) {
-                            auto& vec = lvl_old_it->second.orders;
-                            auto ord_it = std::find_if(vec.begin(), vec.end(), [&](const MboMsg& o){return o.order_id==mbo.order_id;});
-                            if (ord_it!=vec.end()) {
-                                if (oid_it->second.price != mbo.price) { // price change => remove then reinsert losing priority
-                                    // Reuse existing MboMsg; update in place then move
-                                    ord_it->price = mbo.price; ord_it->size = mbo.size;
-                                    auto& side_new = (mbo.side==Side::Bid)? pb.bids : pb.asks;
-                                    side_new.levels[mbo.price].orders.push_back(std::move(*ord_it));
-                                    vec.erase(ord_it);
-                                    if (vec.empty()) side_old.levels.erase(lvl_old_it);
-                                    oid_it->second.price = mbo.price; oid_it->second.side = mbo.side;
-                                } else {
-                                    // same price adjust size; if size increases lose priority => move to end
-                                    if (ord_it->size < mbo.size) { 
-                                        ord_it->size = mbo.size; 
-                                        auto temp = std::move(*ord_it); 
-                                        vec.erase(ord_it); 
-                                        vec.push_back(std::move(temp)); 
-                                    }
-                                    else { ord_it->size = mbo.size; }
-                                }
-                            }
-                        }
-                        break; }
-                    case Action::Trade: case Action::Fill: case Action::None: default: break; // ignore
-                }
-            
-            // Record latency after processing
-            auto end = std::chrono::high_resolution_clock::now();
-            auto latency_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
-            metrics_.record_latency(latency_ns);
-            metrics_.total_messages.fetch_add(1, std::memory_order_relaxed);
-            
-            return databento::Continue;
-        });
+        }
         
     auto replay_end = std::chrono::high_resolution_clock::now();
-    metrics_.replay_duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(replay_end - replay_start).count();
+    if (!follow_.enabled) metrics_.replay_duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(replay_end - replay_start).count();
         
     } catch (const databento::DbnResponseError& e) {
         metrics_.replay_errors.fetch_add(1, std::memory_order_relaxed);
         metrics_.set_last_error(e.what());
-        return std::string("{\"error\": \"DbnResponseError:")+e.what()+"\"}";
+        snap.error = std::string("{\"error\": \"DbnResponseError:")+e.what()+"\"}";
+        return snap;
     } catch (const std::exception& e) {
         metrics_.replay_errors.fetch_add(1, std::memory_order_relaxed);
         metrics_.set_last_error(e.what());
-        return std::string("{\"error\": \"Exception:")+e.what()+"\"}";
+        snap.error = std::string("{\"error\": \"Exception:")+e.what()+"\"}";
+        return snap;
     }
-    // Build JSON (pretty, top-to-bottom). Prices formatted as decimal with 2 places (raw / 1e9).
-    auto ns_to_iso = [](UnixNanos ts){ return databento::ToIso8601(ts); };
-    auto fmt_price = [](int64_t px){ if (px==databento::kUndefPrice) return std::string("null"); std::ostringstream os; os.setf(std::ios::fixed); os<<std::setprecision(2)<< (double)px/1e9; return os.str(); };
-    std::ostringstream oss; oss << "{\n  \"instruments\": [\n";
-    bool first_inst=true;
-    for (auto& kv : instruments) {
-        auto& inst = kv.second; if (!first_inst) oss << ",\n"; first_inst=false;
-        oss << "    {\n      \"instrument_id\": "<<inst.instrument_id<<",\n      \"publishers\": [\n";
-        // aggregated bbo computation accumulates while iterating
-        int64_t agg_bid_px = databento::kUndefPrice; uint32_t agg_bid_sz=0, agg_bid_ct=0;
-        int64_t agg_ask_px = databento::kUndefPrice; uint32_t agg_ask_sz=0, agg_ask_ct=0;
-        bool first_pub=true;
-        for (auto& pb : inst.pub_books) {
-            // publisher best
-            auto best_bid_it = pb.bids.levels.rbegin();
-            int64_t bid_px = (best_bid_it==pb.bids.levels.rend()? databento::kUndefPrice : best_bid_it->first);
-            uint32_t bid_sz=0,bid_ct=0; if (bid_px!=databento::kUndefPrice){ for (auto& o: best_bid_it->second.orders){ bid_sz += o.size; if(!o.flags.IsTob()) ++bid_ct; }}
-            auto best_ask_it = pb.asks.levels.begin();
-            int64_t ask_px = (best_ask_it==pb.asks.levels.end()? databento::kUndefPrice : best_ask_it->first);
-            uint32_t ask_sz=0,ask_ct=0; if (ask_px!=databento::kUndefPrice){ for (auto& o: best_ask_it->second.orders){ ask_sz += o.size; if(!o.flags.IsTob()) ++ask_ct; }}
-            if (bid_px!=databento::kUndefPrice){ if (agg_bid_px==databento::kUndefPrice || bid_px>agg_bid_px){ agg_bid_px=bid_px; agg_bid_sz=bid_sz; agg_bid_ct=bid_ct; } else if (bid_px==agg_bid_px){ agg_bid_sz+=bid_sz; agg_bid_ct+=bid_ct; }}
-            if (ask_px!=databento::kUndefPrice){ if (agg_ask_px==databento::kUndefPrice || ask_px<agg_ask_px){ agg_ask_px=ask_px; agg_ask_sz=ask_sz; agg_ask_ct=ask_ct; } else if (ask_px==agg_ask_px){ agg_ask_sz+=ask_sz; agg_ask_ct+=ask_ct; }}
-            if (!first_pub) oss << ",\n"; first_pub=false;
-            oss << "        {\n          \"publisher_id\": "<<pb.publisher_id<<",\n          \"bbo\": {\n            \"bid\": {\"price\": "<<fmt_price(bid_px)<<", \"size\": "<<bid_sz<<", \"count\": "<<bid_ct<<"},\n            \"ask\": {\"price\": "<<fmt_price(ask_px)<<", \"size\": "<<ask_sz<<", \"count\": "<<ask_ct<<"}\n          },\n          \"levels\": {\n            \"bids\": [\n";
-            {
-              size_t emitted=0; 
-              for (auto rit=pb.bids.levels.rbegin(); rit!=pb.bids.levels.rend(); ++rit){
-                if (levels!=0 && emitted>=levels) break;
-                uint32_t sz=0,ct=0; for (auto& o: rit->second.orders){ sz+=o.size; if(!o.flags.IsTob()) ++ct; }
-                if (emitted>0) oss << ",";
-                oss << "              {\"price\": "<<fmt_price(rit->first)<<", \"size\": "<<sz<<", \"count\": "<<ct<<"}\n";
-                ++emitted;
-              }
-            }
-            oss << "            ],\n            \"asks\": [\n";
-            {
-              size_t emitted=0; 
-              for (auto it=pb.asks.levels.begin(); it!=pb.asks.levels.end(); ++it){
-                if (levels!=0 && emitted>=levels) break;
-                uint32_t sz=0,ct=0; for (auto& o: it->second.orders){ sz+=o.size; if(!o.flags.IsTob()) ++ct; }
-                if (emitted>0) oss << ",";
-                oss << "              {\"price\": "<<fmt_price(it->first)<<", \"size\": "<<sz<<", \"count\": "<<ct<<"}\n";
-                ++emitted;
-              }
-            }
-            oss << "            ]\n          }\n        }"; // end publisher
-        }
-        oss << "\n      ],\n      \"aggregated_bbo\": {\n        \"bid\": {\"price\": "<<fmt_price(agg_bid_px)<<", \"size\": "<<agg_bid_sz<<", \"count\": "<<agg_bid_ct<<"},\n        \"ask\": {\"price\": "<<fmt_price(agg_ask_px)<<", \"size\": "<<agg_ask_sz<<", \"count\": "<<agg_ask_ct<<"}\n      }\n    }";
+    if (sampler) {
+        sampler->flush();
+        metrics_.sampled_rows.store(sampler->rows_written(), std::memory_order_relaxed);
     }
-    oss << "\n  ],\n  \"last_ts_recv_iso\": \""<< ns_to_iso(last_ts_recv) <<"\",\n  \"mbo_count\": "<<mbo_count<<"\n}\n";
-    return oss.str();
+    if (mbp) {
+        mbp->finish();
+        metrics_.mbp_records.store(mbp->records_written(), std::memory_order_relaxed);
+    }
+    build_snapshot(snap);
+    return snap;
 #endif
 }
 
 void Engine::save_aggregated_orderbook_json(const std::string& path, std::size_t levels) const {
-    std::ofstream ofs(path); if (!ofs.is_open()) return; ofs << reconstruct_orderbook_json(levels);
+    save_aggregated_orderbook(path, levels, SnapshotFormat::Json);
+}
+
+void Engine::save_aggregated_orderbook(const std::string& path, std::size_t levels, SnapshotFormat format) const {
+    std::unique_ptr<BookSampler> sampler;
+    if (sampler_config_.enabled()) {
+        try {
+            sampler = std::make_unique<BookSampler>(sampler_config_);
+        } catch (const std::exception& e) {
+            metrics_.set_last_error(e.what());
+        }
+    }
+#ifdef HFT_HAS_DATABENTO
+    std::unique_ptr<MbpFeedWriter> mbp;
+    if (mbp_config_.enabled()) {
+        try {
+            mbp = std::make_unique<MbpFeedWriter>(mbp_config_);
+        } catch (const std::exception& e) {
+            metrics_.set_last_error(e.what());
+        }
+    }
+    auto snap = std::make_shared<const BookSnapshot>(reconstruct_snapshot(sampler.get(), mbp.get()));
+#else
+    auto snap = std::make_shared<const BookSnapshot>(reconstruct_snapshot(sampler.get()));
+#endif
+    publish_snapshot(snap); // full depth is published; `levels` only caps the file
+    try {
+        save_snapshot(*snap, path, format, levels);
+    } catch (const std::exception& e) {
+        metrics_.set_last_error(e.what());
+    }
+}
+
+void Engine::save_book(const std::string& path, SnapshotFormat format) const {
+    book_.save(path, format);
+}
+
+void Engine::publish_snapshot(std::shared_ptr<const BookSnapshot> snap) const {
+    auto next = std::make_unique<PublishedBook>();
+    next->json = std::make_shared<const std::string>(snapshot_to_json(*snap));
+    std::lock_guard<std::mutex> lock(publish_mutex_);
+    if (snap->error.empty()) {
+        next->analytics = analytics_.update(*snap); // unchanged instruments are reused, not recomputed
+        next->analytics_json = std::make_shared<const std::string>(analytics_to_json(*next->analytics));
+    }
+    next->snapshot = std::move(snap);
+    // The new view is visible before the version is announced, so a woken reader never sees an older body
+    next->version = updates_.version() + 1;
+    published_.publish(std::move(next));
+    updates_.publish();
+    metrics_.retired_book_views.store(published_.retired(), std::memory_order_relaxed);
+}
+
+PublishedBook Engine::published() const {
+    return published_.read([](const PublishedBook* p) { return p ? *p : PublishedBook{}; });
+}
+
+std::shared_ptr<const BookSnapshot> Engine::published_snapshot(uint64_t* version) const {
+    return published_.read([&](const PublishedBook* p) -> std::shared_ptr<const BookSnapshot> {
+        if (version) *version = p ? p->version : 0;
+        return p ? p->snapshot : nullptr;
+    });
+}
+
+std::shared_ptr<const std::string> Engine::published_orderbook_json(uint64_t* version) const {
+    return published_.read([&](const PublishedBook* p) -> std::shared_ptr<const std::string> {
+        if (version) *version = p ? p->version : 0;
+        return p ? p->json : nullptr;
+    });
+}
+
+std::shared_ptr<const BookAnalytics> Engine::published_analytics(uint64_t* version) const {
+    return published_.read([&](const PublishedBook* p) -> std::shared_ptr<const BookAnalytics> {
+        if (version) *version = p ? p->version : 0;
+        return p ? p->analytics : nullptr;
+    });
+}
+
+std::shared_ptr<const std::string> Engine::published_analytics_json(uint64_t* version) const {
+    return published_.read([&](const PublishedBook* p) -> std::shared_ptr<const std::string> {
+        if (version) *version = p ? p->version : 0;
+        return p ? p->analytics_json : nullptr;
+    });
+}
+
+void Engine::set_analytics_config(AnalyticsConfig config) {
+    std::lock_guard<std::mutex> lock(publish_mutex_);
+    analytics_.set_config(std::move(config));
+}
+
+void Engine::start_verifier(VerifierOptions options) {
+    if (verifier_) return;
+    verifier_ = std::make_unique<BookVerifier>(
+        [this](uint64_t* version) { return published_snapshot(version); }, updates_, metrics_,
+        [this] { level_recount_requested_.store(true, std::memory_order_relaxed); }, options);
+    verifier_->start();
+}
+
+Engine::~Engine() {
+    if (verifier_) verifier_->stop();
 }
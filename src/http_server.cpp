@@ -0,0 +1,401 @@
+#include "../include/http_server.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+constexpr int kMaxEvents = 256;
+constexpr int kLoopTimeoutMs = 1000; // housekeeping tick (idle/slow-client sweep, heartbeats)
+
+bool iequals(const std::string& a, const std::string& b) {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(),
+        [](char x, char y) { return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y)); });
+}
+
+std::string trim(const std::string& s) {
+    auto b = s.find_first_not_of(" \t");
+    if (b == std::string::npos) return {};
+    auto e = s.find_last_not_of(" \t");
+    return s.substr(b, e - b + 1);
+}
+
+const char* status_text(int status) {
+    switch (status) {
+        case 200: return "OK";
+        case 304: return "Not Modified";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 406: return "Not Acceptable";
+        case 431: return "Request Header Fields Too Large";
+        case 503: return "Service Unavailable";
+        default: return "Unknown";
+    }
+}
+
+std::shared_ptr<const std::string> make_payload(std::string s) {
+    return std::make_shared<const std::string>(std::move(s));
+}
+} // namespace
+
+std::string HttpRequest::header(const std::string& name) const {
+    for (const auto& [k, v] : headers) {
+        if (iequals(k, name)) return v;
+    }
+    return {};
+}
+
+EpollHttpServer::EpollHttpServer(EpollServerOptions options, EpollServerHooks hooks)
+    : options_(options), hooks_(std::move(hooks)), heartbeat_(make_payload(": keep-alive\n\n")) {}
+
+EpollHttpServer::~EpollHttpServer() {
+    stop();
+    for (auto& kv : conns_) ::close(kv.first);
+    if (listen_fd_ >= 0) ::close(listen_fd_);
+    if (epoll_fd_ >= 0) ::close(epoll_fd_);
+    if (wake_fd_ >= 0) ::close(wake_fd_);
+}
+
+bool EpollHttpServer::listen(const std::string& host, int port) {
+    listen_fd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) return false;
+    int one = 1;
+    ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (::inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1) return false;
+    if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) return false;
+    if (::listen(listen_fd_, SOMAXCONN) < 0) return false;
+
+    epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+    wake_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_fd_ < 0 || wake_fd_ < 0) return false;
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = listen_fd_;
+    ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &ev);
+    ev.data.fd = wake_fd_;
+    ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &ev);
+
+    epoll_event events[kMaxEvents];
+    auto last_sweep = clock::now();
+    while (running_.load(std::memory_order_acquire)) {
+        int n = ::epoll_wait(epoll_fd_, events, kMaxEvents, kLoopTimeoutMs);
+        if (n < 0 && errno != EINTR) break;
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == listen_fd_) { accept_all(); continue; }
+            if (fd == wake_fd_) {
+                uint64_t count;
+                while (::read(wake_fd_, &count, sizeof(count)) > 0) {}
+                drain_broadcasts();
+                continue;
+            }
+            auto it = conns_.find(fd);
+            if (it == conns_.end()) continue;
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) { close_connection(fd); continue; }
+            if (events[i].events & EPOLLIN) {
+                on_readable(it->second);
+                it = conns_.find(fd);
+                if (it == conns_.end()) continue;
+            }
+            if (events[i].events & EPOLLOUT) on_writable(it->second);
+        }
+        auto now = clock::now();
+        if (now - last_sweep >= std::chrono::milliseconds(kLoopTimeoutMs)) {
+            sweep(now);
+            last_sweep = now;
+        }
+    }
+    std::vector<int> fds;
+    fds.reserve(conns_.size());
+    for (auto& kv : conns_) fds.push_back(kv.first);
+    for (int fd : fds) close_connection(fd);
+    return true;
+}
+
+void EpollHttpServer::stop() {
+    running_.store(false, std::memory_order_release);
+    if (wake_fd_ >= 0) {
+        uint64_t one = 1;
+        [[maybe_unused]] auto r = ::write(wake_fd_, &one, sizeof(one));
+    }
+}
+
+void EpollHttpServer::broadcast(std::shared_ptr<const std::string> event, const std::string& channel) {
+    {
+        std::lock_guard<std::mutex> lock(broadcast_mutex_);
+        pending_broadcasts_.emplace_back(channel, std::move(event));
+    }
+    if (wake_fd_ >= 0) {
+        uint64_t one = 1;
+        [[maybe_unused]] auto r = ::write(wake_fd_, &one, sizeof(one));
+    }
+}
+
+void EpollHttpServer::accept_all() {
+    while (true) {
+        int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return; // EAGAIN or transient error; level-triggered epoll retries
+        if (conns_.size() >= options_.max_connections) { ::close(fd); continue; }
+        int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) < 0) { ::close(fd); continue; }
+        Connection& c = conns_[fd];
+        c.fd = fd;
+        c.last_activity = c.last_progress = c.last_write = clock::now();
+        open_connections_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void EpollHttpServer::on_readable(Connection& c) {
+    char buf[16 * 1024];
+    // Buffered input never exceeds max_request_bytes + 1 (one byte over lets process_requests
+    // reject an oversize request). A pipelining client that does not read its responses fills
+    // it and is then no longer read from until the queued output drains (update_interest).
+    const std::size_t cap = options_.max_request_bytes + 1;
+    while (true) {
+        const std::size_t room = c.streaming ? sizeof(buf) : std::min(sizeof(buf), cap - std::min(cap, c.in.size()));
+        if (room == 0) break;
+        ssize_t r = ::recv(c.fd, buf, room, 0);
+        if (r > 0) {
+            c.last_activity = clock::now();
+            if (!c.streaming) c.in.append(buf, static_cast<std::size_t>(r)); // streams ignore client input
+            if (static_cast<std::size_t>(r) < room) break;
+            continue;
+        }
+        if (r == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) { close_connection(c.fd); return; }
+        if (errno == EINTR) continue;
+        break;
+    }
+    int fd = c.fd;
+    if (!process_requests(c)) { close_connection(fd); return; }
+    on_writable(c);
+}
+
+bool EpollHttpServer::process_requests(Connection& c) {
+    // One request in flight at a time: while a response is still queued we stop parsing,
+    // which bounds buffered output for pipelining clients.
+    while (!c.streaming && !c.close_after_write && c.pending == 0) {
+        auto header_end = c.in.find("\r\n\r\n");
+        if (header_end == std::string::npos) {
+            if (c.in.size() > options_.max_request_bytes) {
+                HttpResponse res;
+                res.status = 431;
+                res.set_content("{\"error\": \"request too large\"}", "application/json");
+                send_response(c, HttpRequest{}, res, false);
+            }
+            return true;
+        }
+        HttpRequest req;
+        std::size_t line_end = c.in.find("\r\n");
+        std::string line = c.in.substr(0, line_end);
+        auto sp1 = line.find(' ');
+        auto sp2 = line.find(' ', sp1 == std::string::npos ? sp1 : sp1 + 1);
+        if (sp1 == std::string::npos || sp2 == std::string::npos) return false;
+        req.method = line.substr(0, sp1);
+        std::string target = line.substr(sp1 + 1, sp2 - sp1 - 1);
+        std::string version = line.substr(sp2 + 1);
+        auto q = target.find('?');
+        req.path = target.substr(0, q);
+        if (q != std::string::npos) req.query = target.substr(q + 1);
+
+        std::size_t pos = line_end + 2;
+        while (pos < header_end) {
+            std::size_t eol = c.in.find("\r\n", pos);
+            auto colon = c.in.find(':', pos);
+            if (colon != std::string::npos && colon < eol) {
+                req.headers.emplace_back(c.in.substr(pos, colon - pos), trim(c.in.substr(colon + 1, eol - colon - 1)));
+            }
+            pos = eol + 2;
+        }
+        std::size_t content_length = 0;
+        std::string cl = req.header("Content-Length");
+        if (!cl.empty()) {
+            try { content_length = static_cast<std::size_t>(std::stoull(cl)); } catch (...) { return false; }
+        }
+        if (header_end + 4 + content_length > options_.max_request_bytes) {
+            HttpResponse res;
+            res.status = 431;
+            res.set_content("{\"error\": \"request too large\"}", "application/json");
+            send_response(c, req, res, false);
+            return true;
+        }
+        if (c.in.size() < header_end + 4 + content_length) return true; // body still arriving (ignored)
+        c.in.erase(0, header_end + 4 + content_length);
+
+        std::string connection = req.header("Connection");
+        bool keep_alive = (version == "HTTP/1.1") ? !iequals(connection, "close") : iequals(connection, "keep-alive");
+
+        HttpResponse res;
+        if (req.method != "GET" && req.method != "HEAD") {
+            res.status = 405;
+            res.set_content("{\"error\": \"method not allowed\"}", "application/json");
+        } else if (auto it = routes_.find(req.path); it != routes_.end()) {
+            it->second(req, res);
+        } else {
+            res.status = 404;
+            res.set_content("{\"error\": \"not found\"}", "application/json");
+        }
+        send_response(c, req, res, keep_alive);
+    }
+    return true;
+}
+
+void EpollHttpServer::send_response(Connection& c, const HttpRequest& req, HttpResponse& res, bool keep_alive) {
+    std::string head = "HTTP/1.1 " + std::to_string(res.status) + " " + status_text(res.status) + "\r\n";
+    if (res.stream) {
+        // Event stream: no length, delimited by connection close
+        head += "Content-Type: text/event-stream\r\nCache-Control: no-cache\r\nConnection: keep-alive\r\n";
+    } else {
+        std::size_t len = res.body ? res.body->size() : 0;
+        if (res.status != 304) head += "Content-Type: " + res.content_type + "\r\n";
+        head += "Content-Length: " + std::to_string(res.status == 304 ? 0 : len) + "\r\n";
+        head += keep_alive ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+    }
+    for (const auto& [k, v] : res.headers) head += k + ": " + v + "\r\n";
+    head += "\r\n";
+    enqueue(c, make_payload(std::move(head)));
+    if (res.body && req.method != "HEAD" && res.status != 304) enqueue(c, res.body);
+
+    if (res.stream) {
+        c.streaming = true;
+        c.channel = res.stream_channel;
+        c.in.clear();
+        c.in.shrink_to_fit();
+        if (hooks_.on_stream_open) hooks_.on_stream_open();
+        auto last = last_broadcast_.find(c.channel);
+        if (last != last_broadcast_.end()) {
+            enqueue(c, last->second);
+            if (hooks_.on_events_sent) hooks_.on_events_sent(1);
+        }
+    } else if (!keep_alive) {
+        c.close_after_write = true;
+    }
+}
+
+void EpollHttpServer::enqueue(Connection& c, std::shared_ptr<const std::string> data) {
+    if (!data || data->empty()) return;
+    if (c.pending == 0) c.last_progress = clock::now(); // slow-client window starts when output backs up
+    c.pending += data->size();
+    c.out.push_back(Chunk{std::move(data), 0});
+}
+
+void EpollHttpServer::on_writable(Connection& c) {
+    while (!c.out.empty()) {
+        Chunk& chunk = c.out.front();
+        const std::string& s = *chunk.data;
+        ssize_t w = ::send(c.fd, s.data() + chunk.offset, s.size() - chunk.offset, MSG_NOSIGNAL);
+        if (w < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            if (errno == EINTR) continue;
+            close_connection(c.fd);
+            return;
+        }
+        auto now = clock::now();
+        c.last_progress = c.last_write = c.last_activity = now;
+        chunk.offset += static_cast<std::size_t>(w);
+        c.pending -= static_cast<std::size_t>(w);
+        if (chunk.offset == s.size()) c.out.pop_front();
+    }
+    if (c.out.empty() && c.close_after_write) { close_connection(c.fd); return; }
+    if (c.out.empty() && !c.streaming && !c.in.empty()) {
+        // Pipelined request waiting behind the previous response
+        int fd = c.fd;
+        if (!process_requests(c)) { close_connection(fd); return; }
+        if (!c.out.empty()) { on_writable(c); return; }
+    }
+    update_interest(c);
+}
+
+void EpollHttpServer::update_interest(Connection& c) {
+    bool want = !c.out.empty();
+    bool paused = !c.streaming && c.in.size() > options_.max_request_bytes;
+    if (want == c.want_write && paused == c.read_paused) return;
+    c.want_write = want;
+    c.read_paused = paused;
+    epoll_event ev{};
+    ev.events = (paused ? 0u : EPOLLIN) | (want ? EPOLLOUT : 0u);
+    ev.data.fd = c.fd;
+    ::epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, c.fd, &ev);
+}
+
+void EpollHttpServer::close_connection(int fd) {
+    auto it = conns_.find(fd);
+    if (it == conns_.end()) return;
+    if (it->second.streaming && hooks_.on_stream_close) hooks_.on_stream_close();
+    ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+    ::close(fd);
+    conns_.erase(it);
+    open_connections_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void EpollHttpServer::drain_broadcasts() {
+    std::vector<std::pair<std::string, std::shared_ptr<const std::string>>> batch;
+    {
+        std::lock_guard<std::mutex> lock(broadcast_mutex_);
+        batch.swap(pending_broadcasts_);
+    }
+    if (batch.empty()) return;
+    // Only the newest payload per channel matters to a stream; older queued ones are superseded
+    std::vector<std::string> channels;
+    for (auto& [channel, event] : batch) {
+        if (std::find(channels.begin(), channels.end(), channel) == channels.end()) channels.push_back(channel);
+        last_broadcast_[channel] = std::move(event);
+    }
+    std::size_t sent = 0;
+    std::vector<int> touched;
+    for (auto& [fd, c] : conns_) {
+        if (!c.streaming || std::find(channels.begin(), channels.end(), c.channel) == channels.end()) continue;
+        const auto& event = last_broadcast_[c.channel];
+        if (c.pending + event->size() > options_.max_pending_bytes) {
+            // Backpressure: client is behind, skip this version; eviction handled by sweep
+            if (hooks_.on_event_dropped) hooks_.on_event_dropped();
+            continue;
+        }
+        enqueue(c, event);
+        touched.push_back(fd);
+        ++sent;
+    }
+    for (int fd : touched) {
+        auto it = conns_.find(fd);
+        if (it != conns_.end()) on_writable(it->second);
+    }
+    if (sent && hooks_.on_events_sent) hooks_.on_events_sent(sent);
+}
+
+void EpollHttpServer::sweep(clock::time_point now) {
+    std::vector<int> to_close;
+    std::vector<int> to_ping;
+    for (auto& [fd, c] : conns_) {
+        if (c.pending > 0 && now - c.last_progress > options_.slow_client_timeout) {
+            to_close.push_back(fd);
+            if (hooks_.on_evicted) hooks_.on_evicted();
+        } else if (!c.streaming && c.pending == 0 && now - c.last_activity > options_.idle_timeout) {
+            to_close.push_back(fd);
+        } else if (c.streaming && c.pending == 0 && now - c.last_write > options_.heartbeat) {
+            to_ping.push_back(fd);
+        }
+    }
+    for (int fd : to_close) close_connection(fd);
+    for (int fd : to_ping) {
+        auto it = conns_.find(fd);
+        if (it == conns_.end()) continue;
+        enqueue(it->second, heartbeat_);
+        on_writable(it->second);
+    }
+}
@@ -2,40 +2,54 @@
 #include "include/engine.h"
 #include "include/logger.h"
 #include "include/apiserver.h"
+#include "include/alloc_counter.h"
+#include <algorithm>
 #include <iostream>
 #include <filesystem>
 #include <thread>
 #include <csignal>
+#include <cerrno>
+#include <unistd.h>
 
-// Global pointers for signal handlers (simple approach)
-static Engine* g_engine_ptr = nullptr;
-static ApiServer* g_api_ptr = nullptr;
+// Signal handlers only flag shutdown and write the signal number to this self-pipe; the
+// watcher thread in main() does the actual stopping (mutexes are not async-signal-safe)
 static std::atomic<bool> g_shutdown{false};
+static int g_signal_pipe[2] = {-1, -1};
 
 int main(int argc, char* argv[]) {
     AsyncLogger logger; // simple logger
 
-    // Determine dbn path: precedence ENV(DBN_FILE) > CLI arg > autodiscover.
-    std::string dbn_path;
+    // Determine dbn inputs: precedence ENV(DBN_FILE) > CLI args > autodiscover.
+    // DBN_FILE and each argument may be a file, a directory, a glob, or a comma-separated list.
+    std::vector<std::string> dbn_paths;
     if (const char* env_dbn = std::getenv("DBN_FILE")) {
-        dbn_path = env_dbn;
+        dbn_paths = expand_dbn_inputs(env_dbn);
     } else if (argc > 1) {
-        dbn_path = argv[1];
+        for (int i = 1; i < argc; ++i) {
+            for (auto& p : expand_dbn_inputs(argv[i])) {
+                if (std::find(dbn_paths.begin(), dbn_paths.end(), p) == dbn_paths.end()) dbn_paths.push_back(std::move(p));
+            }
+        }
     } else {
         for (const auto& entry : std::filesystem::directory_iterator(".")) {
-            if (entry.path().extension() == ".dbn") { dbn_path = entry.path().string(); break; }
+            if (entry.path().extension() == ".dbn") { dbn_paths.push_back(entry.path().string()); break; }
         }
     }
 
-    if (dbn_path.empty()) {
+    if (dbn_paths.empty()) {
         std::cerr << "No .dbn file provided or found in project root." << std::endl;
-        std::cerr << "Usage: " << argv[0] << " <file.dbn>" << std::endl;
+        std::cerr << "Usage: " << argv[0] << " <file.dbn|dir|glob>..." << std::endl;
+        return 1;
+    }
+
+    if (::pipe(g_signal_pipe) != 0) {
+        std::cerr << "Failed to create signal pipe" << std::endl;
         return 1;
     }
 
-    Engine engine(dbn_path);
+    Engine engine;
+    engine.set_dbn_paths(dbn_paths);
     engine.init();
-    g_engine_ptr = &engine;
     
     // Determine server port: ENV(PORT) override
     int port = 8080;
@@ -44,26 +58,93 @@ int main(int argc, char* argv[]) {
     }
     // Start API server in background thread
     ApiServer api_server(&engine, port);
-    g_api_ptr = &api_server;
     std::thread api_thread([&api_server, port]() {
         std::cout << "API server starting on http://localhost:" << port << "\n";
         api_server.start();
     });
 
-    // Graceful shutdown via signals: SIGINT/SIGTERM
+    // Graceful shutdown via signals: SIGINT/SIGTERM. A 0 byte on the pipe only releases the
+    // watcher at normal exit.
+    std::thread signal_watcher([&engine, &api_server]() {
+        char sig = 0;
+        while (::read(g_signal_pipe[0], &sig, 1) < 0 && errno == EINTR) {}
+        if (sig == 0) return;
+        std::cerr << "\nSignal " << static_cast<int>(sig) << " received. Initiating graceful shutdown..." << std::endl;
+        engine.request_stop();
+        api_server.stop();
+    });
+    auto release_watcher = [&signal_watcher]() {
+        const char none = 0;
+        if (::write(g_signal_pipe[1], &none, 1) < 0) { /* watcher already gone */ }
+        signal_watcher.join();
+    };
     auto signal_handler = [](int sig){
-        if (g_shutdown.load()) return; // already handling
-        g_shutdown.store(true);
-        if (g_engine_ptr) g_engine_ptr->request_stop();
-        if (g_api_ptr) g_api_ptr->stop();
-        std::cerr << "\nSignal " << sig << " received. Initiating graceful shutdown..." << std::endl;
+        if (g_shutdown.exchange(true)) return; // already handling
+        const char byte = static_cast<char>(sig);
+        if (::write(g_signal_pipe[1], &byte, 1) < 0) { /* nothing safe to do here */ }
     };
     std::signal(SIGINT, signal_handler);
     std::signal(SIGTERM, signal_handler);
     
     // Thread 1: Replay DBN and build aggregated book (blocking)
     std::cout << "Replaying DBN file...\n";
-    engine.save_aggregated_orderbook_json("aggregated_orderbook.json", 0); // 0 = no limit: include all available levels (single pass replay)
+    // Optional depth time-series: SAMPLE_PATH (.csv or binary) plus SAMPLE_INTERVAL_MS and/or SAMPLE_EVERY_EVENTS
+    if (const char* envp = std::getenv("SAMPLE_PATH")) {
+        SamplerConfig sc;
+        sc.path = envp;
+        sc.format = sample_format_from_path(sc.path);
+        try {
+            if (const char* v = std::getenv("SAMPLE_INTERVAL_MS")) sc.interval_ns = std::stoull(v) * 1000000ull;
+            if (const char* v = std::getenv("SAMPLE_EVERY_EVENTS")) sc.every_events = std::stoull(v);
+            if (const char* v = std::getenv("SAMPLE_DEPTH")) sc.depth = std::stoul(v);
+        } catch (...) { /* ignore malformed values */ }
+        engine.set_sampler_config(sc);
+    }
+    // /analytics shape: ANALYTICS_IMBALANCE_LEVELS, ANALYTICS_DEPTH_LEVELS, ANALYTICS_SWEEP_SIZES (e.g. "1,10,100")
+    {
+        AnalyticsConfig ac;
+        try {
+            if (const char* v = std::getenv("ANALYTICS_IMBALANCE_LEVELS")) ac.imbalance_levels = std::stoul(v);
+            if (const char* v = std::getenv("ANALYTICS_DEPTH_LEVELS")) ac.depth_levels = std::stoul(v);
+        } catch (...) { /* ignore malformed values */ }
+        if (const char* v = std::getenv("ANALYTICS_SWEEP_SIZES")) ac.sweep_sizes = parse_sweep_sizes(v);
+        engine.set_analytics_config(std::move(ac));
+    }
+    // Derived MBP-10 feed: MBP_PATH (DBN file), MBP_DEPTH (levels watched, 1-10)
+    if (const char* envp = std::getenv("MBP_PATH")) {
+        MbpFeedConfig mc;
+        mc.path = envp;
+        try {
+            if (const char* v = std::getenv("MBP_DEPTH")) mc.depth = std::stoul(v);
+        } catch (...) { /* ignore malformed values */ }
+        engine.set_mbp_config(std::move(mc));
+    }
+    // Live tail: FOLLOW=1 keeps applying records appended to the input until Ctrl+C
+    if (const char* v = std::getenv("FOLLOW"); v && std::string(v) == "1") {
+        FollowOptions fo;
+        fo.enabled = true;
+        try {
+            if (const char* ms = std::getenv("FOLLOW_PUBLISH_MS")) fo.publish_interval = std::chrono::milliseconds(std::stoll(ms));
+            if (const char* ms = std::getenv("FOLLOW_POLL_MS")) fo.poll_interval = std::chrono::milliseconds(std::stoll(ms));
+        } catch (...) { /* ignore malformed values */ }
+        engine.set_follow_options(fo);
+        std::cout << "Following " << dbn_paths.front() << " (snapshot file is written on shutdown)\n";
+    }
+    // Book-consistency verifier: on unless VERIFY=0; VERIFY_INTERVAL_MS spaces the sampled audits
+    if (const char* v = std::getenv("VERIFY"); !v || std::string(v) != "0") {
+        VerifierOptions vo;
+        try {
+            if (const char* ms = std::getenv("VERIFY_INTERVAL_MS")) vo.interval = std::chrono::milliseconds(std::stoll(ms));
+        } catch (...) { /* ignore malformed values */ }
+        engine.start_verifier(vo);
+    }
+    if (const char* v = std::getenv("ALLOC_WARMUP_MESSAGES")) {
+        try { engine.set_alloc_warmup(std::stoull(v)); } catch (...) { /* ignore malformed values */ }
+    }
+    // Output encoding follows the extension: .json (default), .bin (binary), .col/.arrow (columnar)
+    std::string snapshot_path = "aggregated_orderbook.json";
+    if (const char* envp = std::getenv("SNAPSHOT_PATH")) snapshot_path = envp;
+    engine.save_aggregated_orderbook(snapshot_path, 0, snapshot_format_from_path(snapshot_path)); // 0 = no limit: include all available levels (single pass replay)
     
     // Optional performance metrics printing (disabled by default when QUIET_METRICS=1)
     bool show_metrics = true;
@@ -85,15 +166,34 @@ int main(int argc, char* argv[]) {
         if (m.p99() > static_cast<double>(latency_warn_threshold_ns)) {
             std::cerr << "[WARN] p99 latency " << m.p99() << " ns exceeded threshold " << latency_warn_threshold_ns << " ns" << std::endl;
         }
+        if (alloc_counter::kEnabled) std::cout << "ingest allocations: " << m.ingest_allocs_per_million() << " per million msgs\n";
+    }
+
+    // Allocation regression gate for benchmark runs: with HFT_COUNT_ALLOCATIONS, exit 3 when the
+    // steady-state rate exceeds ALLOC_BUDGET_PER_MILLION
+    if (const char* envp = std::getenv("ALLOC_BUDGET_PER_MILLION"); envp && alloc_counter::kEnabled) {
+        double budget = 0.0;
+        try { budget = std::stod(envp); } catch (...) {}
+        const double rate = engine.get_metrics().ingest_allocs_per_million();
+        if (rate > budget) {
+            std::cerr << "[FAIL] " << rate << " ingest allocations per million msgs exceed budget " << budget << std::endl;
+            engine.request_stop();
+            api_server.stop();
+            api_thread.join();
+            release_watcher();
+            return 3;
+        }
     }
     
     std::cout << "\nAPI server running. Test with:\n";
     std::cout << "  curl http://localhost:" << port << "/orderbook\n";
     std::cout << "  curl http://localhost:" << port << "/metrics\n";
+    std::cout << "  curl http://localhost:" << port << "/analytics\n";
     std::cout << "Press Ctrl+C to exit.\n";
     
     // Keep main thread alive for API server until signal triggers stop
     api_thread.join();
+    release_watcher();
     std::cout << "Shutdown complete." << std::endl;
     return 0;
 }
@@ -0,0 +1,315 @@
+#include "../include/mbo_source.h"
+#include "../include/alloc_counter.h"
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <fcntl.h>
+#include <glob.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+bool is_dbn_name(const std::string& name) {
+    auto ends_with = [&](const std::string& ext) {
+        return name.size() >= ext.size() && name.compare(name.size() - ext.size(), ext.size(), ext) == 0;
+    };
+    return ends_with(".dbn") || ends_with(".dbn.zst");
+}
+
+} // namespace
+
+std::vector<std::string> expand_dbn_inputs(const std::string& spec) {
+    std::vector<std::string> out;
+    auto add = [&](std::string path) {
+        if (std::find(out.begin(), out.end(), path) == out.end()) out.push_back(std::move(path));
+    };
+    std::stringstream ss(spec);
+    std::string entry;
+    while (std::getline(ss, entry, ',')) {
+        if (entry.empty()) continue;
+        std::error_code ec;
+        if (std::filesystem::is_directory(entry, ec)) {
+            std::vector<std::string> files;
+            for (const auto& de : std::filesystem::directory_iterator(entry, ec)) {
+                if (de.is_regular_file() && is_dbn_name(de.path().filename().string())) files.push_back(de.path().string());
+            }
+            std::sort(files.begin(), files.end());
+            for (auto& f : files) add(std::move(f));
+        } else if (entry.find_first_of("*?[") != std::string::npos) {
+            glob_t g{};
+            if (::glob(entry.c_str(), GLOB_NOCHECK, nullptr, &g) == 0) {
+                for (std::size_t i = 0; i < g.gl_pathc; ++i) add(g.gl_pathv[i]); // glob() sorts
+            }
+            ::globfree(&g);
+        } else {
+            add(entry);
+        }
+    }
+    return out;
+}
+
+#ifdef HFT_HAS_DATABENTO
+
+using databento::MboMsg;
+
+struct MergedMboReader::Source {
+    std::string path;
+    std::unique_ptr<databento::DbnFileStore> store; // inline (single input) mode only
+    std::thread decoder;
+
+    // Consumer side: batch being merged
+    std::vector<MboMsg> current;
+    std::size_t pos = 0;
+
+    // Decoder -> consumer handoff, bounded by readahead_batches
+    std::mutex mutex;
+    std::condition_variable ready_cv;   // consumer waits for a batch
+    std::condition_variable space_cv;   // decoder waits for room
+    std::deque<std::vector<MboMsg>> ready;
+    std::vector<std::vector<MboMsg>> spare; // drained batches returned for reuse
+    bool done = false;
+    std::exception_ptr error;
+
+    std::uint64_t head_ts() const { return current[pos].ts_recv.time_since_epoch().count(); }
+};
+
+MergedMboReader::MergedMboReader(std::vector<std::string> paths, MergeOptions options) : options_(options) {
+    if (options_.batch_records == 0) options_.batch_records = 1;
+    if (options_.readahead_batches == 0) options_.readahead_batches = 1;
+    for (auto& p : paths) {
+        auto s = std::make_unique<Source>();
+        s->path = std::move(p);
+        sources_.push_back(std::move(s));
+    }
+    if (sources_.size() == 1) {
+        sources_[0]->store = std::make_unique<databento::DbnFileStore>(nullptr, sources_[0]->path,
+                                                                       databento::VersionUpgradePolicy::UpgradeToV2);
+        return;
+    }
+    for (auto& sp : sources_) {
+        Source* s = sp.get();
+        s->decoder = std::thread([this, s] {
+            alloc_counter::ScopedShare share(&decoder_allocations_);
+            auto take_batch = [&] {
+                std::vector<MboMsg> batch;
+                std::lock_guard<std::mutex> lock(s->mutex);
+                if (!s->spare.empty()) {
+                    batch = std::move(s->spare.back());
+                    s->spare.pop_back();
+                }
+                batch.clear();
+                batch.reserve(options_.batch_records);
+                return batch;
+            };
+            auto hand_off = [&](std::vector<MboMsg>&& batch) {
+                std::unique_lock<std::mutex> lock(s->mutex);
+                s->space_cv.wait(lock, [&] { return s->ready.size() < options_.readahead_batches || stop_.load(); });
+                if (stop_.load()) return false;
+                s->ready.push_back(std::move(batch));
+                s->ready_cv.notify_one();
+                return true;
+            };
+            try {
+                databento::DbnFileStore store(nullptr, s->path, databento::VersionUpgradePolicy::UpgradeToV2);
+                std::vector<MboMsg> batch = take_batch();
+                while (!stop_.load(std::memory_order_relaxed)) {
+                    const databento::Record* rec = store.NextRecord();
+                    if (!rec) break;
+                    if (!rec->Holds<MboMsg>()) continue;
+                    batch.push_back(rec->Get<MboMsg>());
+                    if (batch.size() >= options_.batch_records) {
+                        if (!hand_off(std::move(batch))) break;
+                        batch = take_batch();
+                    }
+                }
+                if (!batch.empty()) hand_off(std::move(batch));
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(s->mutex);
+                s->error = std::current_exception();
+            }
+            std::lock_guard<std::mutex> lock(s->mutex);
+            s->done = true;
+            s->ready_cv.notify_one();
+        });
+    }
+}
+
+MergedMboReader::~MergedMboReader() {
+    stop();
+}
+
+void MergedMboReader::stop() {
+    stop_.store(true);
+    for (auto& s : sources_) {
+        {
+            std::lock_guard<std::mutex> lock(s->mutex);
+            s->space_cv.notify_all();
+        }
+        if (s->decoder.joinable()) s->decoder.join();
+    }
+}
+
+// Moves s to its next record, refilling its batch when drained; false once s is exhausted
+bool MergedMboReader::advance(Source& s) {
+    if (++s.pos < s.current.size()) return true;
+    if (s.store) {
+        s.current.clear();
+        s.pos = 0;
+        while (s.current.size() < options_.batch_records) {
+            const databento::Record* rec = s.store->NextRecord();
+            if (!rec) break;
+            if (rec->Holds<MboMsg>()) s.current.push_back(rec->Get<MboMsg>());
+        }
+        return !s.current.empty();
+    }
+    std::unique_lock<std::mutex> lock(s.mutex);
+    s.ready_cv.wait(lock, [&] { return !s.ready.empty() || s.done; });
+    if (s.ready.empty()) {
+        if (s.error) std::rethrow_exception(s.error);
+        return false;
+    }
+    if (s.current.capacity() > 0) s.spare.push_back(std::move(s.current));
+    s.current = std::move(s.ready.front());
+    s.ready.pop_front();
+    s.pos = 0;
+    s.space_cv.notify_one();
+    return true;
+}
+
+const MboMsg* MergedMboReader::next() {
+    auto later = std::greater<std::pair<std::uint64_t, std::size_t>>();
+    if (!started_) {
+        started_ = true;
+        for (std::size_t i = 0; i < sources_.size(); ++i) {
+            Source& s = *sources_[i];
+            s.pos = s.current.size(); // empty: first advance() loads a batch
+            if (advance(s)) heap_.emplace_back(s.head_ts(), i);
+        }
+        std::make_heap(heap_.begin(), heap_.end(), later);
+    } else if (last_) {
+        const std::size_t idx = heap_.back().second; // popped last time, parked at the back
+        heap_.pop_back();
+        if (advance(*last_)) {
+            heap_.emplace_back(last_->head_ts(), idx);
+            std::push_heap(heap_.begin(), heap_.end(), later);
+        }
+    }
+    if (heap_.empty()) {
+        last_ = nullptr;
+        return nullptr;
+    }
+    std::pop_heap(heap_.begin(), heap_.end(), later); // min moves to the back
+    last_ = sources_[heap_.back().second].get();
+    return &last_->current[last_->pos];
+}
+
+namespace {
+constexpr std::uint8_t kRTypeMbo = 0xA0;
+constexpr std::size_t kTailReadChunk = 1 << 20;
+constexpr std::size_t kDbnPrefixBytes = 8; // "DBN" + version u8 + metadata length u32
+} // namespace
+
+DbnTailReader::DbnTailReader(const std::string& path, std::chrono::milliseconds poll_interval)
+    : path_(path), poll_interval_(poll_interval) {
+    fd_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd_ < 0) throw std::runtime_error("Failed to open DBN file to follow: " + path + ": " + std::strerror(errno));
+    inotify_fd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd_ >= 0 && ::inotify_add_watch(inotify_fd_, path.c_str(), IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB) < 0) {
+        ::close(inotify_fd_);
+        inotify_fd_ = -1; // polling fallback
+    }
+    buffer_.resize(kTailReadChunk);
+}
+
+DbnTailReader::~DbnTailReader() {
+    if (inotify_fd_ >= 0) ::close(inotify_fd_);
+    if (fd_ >= 0) ::close(fd_);
+}
+
+bool DbnTailReader::parse_header() {
+    const std::size_t avail = end_ - pos_;
+    if (avail < kDbnPrefixBytes) return false;
+    const auto* p = reinterpret_cast<const unsigned char*>(buffer_.data() + pos_);
+    if (p[0] == 0x28 && p[1] == 0xB5 && p[2] == 0x2F && p[3] == 0xFD) {
+        throw std::runtime_error("Cannot follow zstd-compressed DBN file: " + path_);
+    }
+    if (p[0] != 'D' || p[1] != 'B' || p[2] != 'N' || p[3] == 0 || p[3] > 3) {
+        throw std::runtime_error("Not a DBN v1-v3 file: " + path_);
+    }
+    const std::uint32_t meta_len = p[4] | (p[5] << 8) | (p[6] << 16) | (static_cast<std::uint32_t>(p[7]) << 24);
+    if (avail < kDbnPrefixBytes + meta_len) return false; // metadata still being written
+    pos_ += kDbnPrefixBytes + meta_len;
+    header_done_ = true;
+    return true;
+}
+
+const databento::MboMsg* DbnTailReader::next() {
+    if (!header_done_ && !parse_header()) return nullptr;
+    while (end_ - pos_ >= 2) {
+        const auto* p = reinterpret_cast<const unsigned char*>(buffer_.data() + pos_);
+        const std::size_t rec_bytes = static_cast<std::size_t>(p[0]) * 4; // length is in 32-bit words
+        if (rec_bytes < 2) throw std::runtime_error("Corrupt DBN record header at offset " + std::to_string(offset()));
+        if (end_ - pos_ < rec_bytes) return nullptr; // partial record: wait for the rest
+        const char* rec = buffer_.data() + pos_;
+        pos_ += rec_bytes;
+        if (p[1] == kRTypeMbo && rec_bytes >= sizeof(databento::MboMsg)) {
+            std::memcpy(&current_, rec, sizeof(current_));
+            return &current_;
+        }
+    }
+    return nullptr;
+}
+
+std::size_t DbnTailReader::refill() {
+    struct stat st{};
+    if (::fstat(fd_, &st) == 0 && static_cast<std::uint64_t>(st.st_size) < buffer_base_ + end_) {
+        throw std::runtime_error("Followed DBN file shrank (truncated or replaced): " + path_);
+    }
+    if (pos_ == end_) { // everything consumed: rewind the cursors, nothing to move
+        buffer_base_ += pos_;
+        pos_ = end_ = 0;
+    } else if (end_ == buffer_.size()) {
+        if (pos_ > buffer_.size() / 2) { // a partial record moves to the front
+            std::memmove(buffer_.data(), buffer_.data() + pos_, end_ - pos_);
+            buffer_base_ += pos_;
+            end_ -= pos_;
+            pos_ = 0;
+        } else {
+            buffer_.resize(buffer_.size() * 2); // unread bytes fill over half the buffer
+        }
+    }
+    ssize_t r;
+    do {
+        r = ::read(fd_, buffer_.data() + end_, buffer_.size() - end_);
+    } while (r < 0 && errno == EINTR);
+    if (r < 0) throw std::runtime_error("Read failed on followed DBN file: " + path_ + ": " + std::strerror(errno));
+    end_ += static_cast<std::size_t>(r);
+    return static_cast<std::size_t>(r);
+}
+
+void DbnTailReader::wait(std::chrono::milliseconds timeout) {
+    if (timeout.count() < 0) timeout = std::chrono::milliseconds(0);
+    if (inotify_fd_ < 0) {
+        std::this_thread::sleep_for(std::min(timeout, poll_interval_));
+        return;
+    }
+    pollfd pfd{inotify_fd_, POLLIN, 0};
+    if (::poll(&pfd, 1, static_cast<int>(timeout.count())) > 0) {
+        alignas(inotify_event) char events[4096];
+        while (::read(inotify_fd_, events, sizeof(events)) > 0) {} // drain; refill() reads the data
+    }
+}
+
+#endif // HFT_HAS_DATABENTO
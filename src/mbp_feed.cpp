@@ -0,0 +1,167 @@
+#include "../include/mbp_feed.h"
+
+#ifdef HFT_HAS_DATABENTO
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include "../include/byte_writer.h"
+
+// Records are appended as the in-memory struct, which is the DBN wire layout on little-endian hosts
+static_assert(sizeof(databento::Mbp10Msg) == 368, "Mbp10Msg must match the DBN MBP-10 record layout");
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "DBN records are little-endian");
+
+namespace {
+
+constexpr std::uint8_t kDbnVersion = 2;
+constexpr std::uint16_t kSchemaMbp10 = 2;
+constexpr std::uint8_t kStypeInstrumentId = 1;
+constexpr std::uint16_t kSymbolCstrLen = 71;     // DBN v2
+constexpr std::size_t kMetadataReservedLen = 53; // DBN v2
+constexpr std::size_t kStartOffset = 8 + 16 + 2; // prefix, dataset, schema
+
+databento::BidAskPair empty_pair() {
+    databento::BidAskPair p{};
+    p.bid_px = databento::kUndefPrice;
+    p.ask_px = databento::kUndefPrice;
+    return p;
+}
+
+// Level index at `price` on the resting side of a trade (the side opposite the aggressor;
+// either side when the aggressor is unknown); depth when it is not among the watched levels
+template <class Levels>
+std::size_t trade_level(const Levels& levels, std::size_t depth, std::int64_t price, databento::Side aggressor) {
+    const bool bids = aggressor != databento::Side::Bid;
+    const bool asks = aggressor != databento::Side::Ask;
+    for (std::size_t i = 0; i < depth; ++i) {
+        if ((bids && levels[i].bid_px == price) || (asks && levels[i].ask_px == price)) return i;
+    }
+    return depth;
+}
+
+bool same_pair(const databento::BidAskPair& a, const databento::BidAskPair& b) {
+    return a.bid_px == b.bid_px && a.ask_px == b.ask_px && a.bid_sz == b.bid_sz && a.ask_sz == b.ask_sz &&
+           a.bid_ct == b.bid_ct && a.ask_ct == b.ask_ct;
+}
+
+// Metadata with no symbology; start/end are placeholders patched by finish()
+void put_metadata(std::string& out) {
+    out.append("DBN", 3);
+    le::put_u8(out, kDbnVersion);
+    const std::size_t length_at = out.size();
+    le::put_u32(out, 0);
+    out.append(16, '\0');                                        // dataset
+    le::put_u16(out, kSchemaMbp10);
+    le::put_u64(out, 0);                                         // start
+    le::put_u64(out, std::numeric_limits<std::uint64_t>::max()); // end (undefined)
+    le::put_u64(out, 0);                                         // limit
+    le::put_u8(out, kStypeInstrumentId);                         // stype_in
+    le::put_u8(out, kStypeInstrumentId);                         // stype_out
+    le::put_u8(out, 0);                                          // ts_out
+    le::put_u16(out, kSymbolCstrLen);
+    out.append(kMetadataReservedLen, '\0');
+    le::put_u32(out, 0); // schema_definition_length
+    for (int list = 0; list < 4; ++list) le::put_u32(out, 0); // symbols, partial, not_found, mappings
+    out.append((8 - out.size() % 8) % 8, '\0');                // records start 8-byte aligned
+    const std::uint32_t length = static_cast<std::uint32_t>(out.size() - length_at - 4);
+    for (int i = 0; i < 4; ++i) out[length_at + i] = static_cast<char>((length >> (8 * i)) & 0xFF);
+}
+
+} // namespace
+
+MbpFeedWriter::MbpFeedWriter(const MbpFeedConfig& config) : config_(config) {
+    config_.depth = std::clamp<std::size_t>(config_.depth, 1, 10);
+    out_.open(config_.path, std::ios::binary | std::ios::trunc);
+    if (!out_.is_open()) {
+        throw std::runtime_error("Failed to open MBP output: " + config_.path);
+    }
+    buffer_.reserve(config_.buffer_bytes + sizeof(databento::Mbp10Msg));
+    put_metadata(buffer_);
+}
+
+MbpFeedWriter::~MbpFeedWriter() {
+    finish();
+}
+
+void MbpFeedWriter::top_of(const MboBook& book, Levels& out) const {
+    out.fill(empty_pair());
+    std::size_t i = 0;
+    for (auto rit = book.bids().rbegin(); rit != book.bids().rend() && i < config_.depth; ++rit, ++i) {
+        out[i].bid_px = rit->first;
+        out[i].bid_sz = rit->second.size;
+        out[i].bid_ct = rit->second.count;
+    }
+    i = 0;
+    for (auto it = book.asks().begin(); it != book.asks().end() && i < config_.depth; ++it, ++i) {
+        out[i].ask_px = it->first;
+        out[i].ask_sz = it->second.size;
+        out[i].ask_ct = it->second.count;
+    }
+}
+
+bool MbpFeedWriter::on_update(const databento::MboMsg& mbo, const MboBook& book) {
+    if (book.index() >= last_.size()) {
+        Levels empty;
+        empty.fill(empty_pair());
+        last_.resize(std::size_t{book.index()} + 1, empty);
+    }
+    Levels& last = last_[book.index()];
+    databento::Mbp10Msg rec{};
+    top_of(book, rec.levels);
+    std::size_t level = 0; // first changed level, or the traded one
+    while (level < config_.depth && same_pair(rec.levels[level], last[level])) ++level;
+    if (mbo.action == databento::Action::Trade) {
+        // Trades leave the levels as they were; depth points at the level traded against
+        level = trade_level(rec.levels, config_.depth, mbo.price, mbo.side);
+        if (level == config_.depth) return false;
+    } else if (level == config_.depth) {
+        return false;
+    }
+
+    rec.hd.length = static_cast<std::uint8_t>(sizeof(rec) / 4);
+    rec.hd.rtype = databento::RType::Mbp10;
+    rec.hd.publisher_id = mbo.hd.publisher_id;
+    rec.hd.instrument_id = mbo.hd.instrument_id;
+    rec.hd.ts_event = mbo.hd.ts_event;
+    rec.price = mbo.price;
+    rec.size = mbo.size;
+    rec.action = mbo.action;
+    rec.side = mbo.side;
+    rec.flags = mbo.flags;
+    rec.depth = static_cast<std::uint8_t>(level);
+    rec.ts_recv = mbo.ts_recv;
+    rec.ts_in_delta = mbo.ts_in_delta;
+    rec.sequence = mbo.sequence;
+    last = rec.levels;
+
+    const std::uint64_t ts = mbo.ts_recv.time_since_epoch().count();
+    if (records_ == 0) first_ts_ = ts;
+    last_ts_ = ts;
+    buffer_.append(reinterpret_cast<const char*>(&rec), sizeof(rec));
+    ++records_;
+    if (buffer_.size() >= config_.buffer_bytes) flush();
+    return true;
+}
+
+void MbpFeedWriter::flush() {
+    if (buffer_.empty() || !out_.is_open()) return;
+    out_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+    out_.flush();
+    buffer_.clear(); // keeps capacity: steady state does not reallocate
+}
+
+void MbpFeedWriter::finish() {
+    if (finished_) return;
+    finished_ = true;
+    flush();
+    if (!out_.is_open()) return;
+    if (records_ > 0) {
+        std::string range;
+        le::put_u64(range, first_ts_);
+        le::put_u64(range, last_ts_ + 1); // end is exclusive
+        out_.seekp(static_cast<std::streamoff>(kStartOffset));
+        out_.write(range.data(), static_cast<std::streamsize>(range.size()));
+    }
+    out_.close();
+}
+
+#endif // HFT_HAS_DATABENTO
@@ -1,13 +1,42 @@
 #include "../include/metrics.h"
 
+namespace {
+// Log-linear bucket: values below 64 map to themselves; above, each power of two is split
+// into 32 buckets keyed by the next five bits below the leading one
+size_t latency_bucket(uint64_t ns) {
+    if (ns < 64) return static_cast<size_t>(ns);
+    const int msb = 63 - __builtin_clzll(ns);
+    const uint64_t mantissa = ns >> (msb - 5); // 32..63
+    return 64 + static_cast<size_t>(msb - 6) * 32 + static_cast<size_t>(mantissa - 32);
+}
+
+double latency_bucket_midpoint(size_t bucket) {
+    if (bucket < 64) return static_cast<double>(bucket);
+    const int shift = static_cast<int>((bucket - 64) / 32) + 1; // msb - 5
+    const uint64_t lower = (32 + (bucket - 64) % 32) << shift;
+    return static_cast<double>(lower) + static_cast<double>(uint64_t{1} << shift) / 2.0;
+}
+} // namespace
+
 void Metrics::record_latency(uint64_t ns) {
+    const auto bucket = static_cast<uint16_t>(latency_bucket(ns));
     std::lock_guard<std::mutex> lock(latency_mutex_);
-    latencies_.push_back(ns);
+    if (latency_buckets_.size() < kLatencyWindow) {
+        if (latency_buckets_.capacity() == 0) latency_buckets_.reserve(kLatencyWindow);
+        latency_buckets_.push_back(bucket);
+    } else {
+        uint16_t& slot = latency_buckets_[latency_count_ % kLatencyWindow];
+        --latency_histogram_[slot]; // the sample leaving the window
+        slot = bucket;
+    }
+    ++latency_histogram_[bucket];
+    ++latency_count_;
 }
 
 void Metrics::set_last_error(const std::string& msg) {
     std::lock_guard<std::mutex> lock(error_mutex_);
     last_error_message_ = msg;
+    last_error_version_.fetch_add(1, std::memory_order_release);
 }
 
 std::string Metrics::last_error() const {
@@ -15,30 +44,24 @@ std::string Metrics::last_error() const {
     return last_error_message_;
 }
 
-double Metrics::p50() const {
-    std::lock_guard<std::mutex> lock(latency_mutex_);
-    if (latencies_.empty()) return 0.0;
-    std::vector<uint64_t> copy = latencies_;
-    std::sort(copy.begin(), copy.end());
-    return static_cast<double>(copy[copy.size() / 2]);
-}
-
-double Metrics::p95() const {
+uint64_t Metrics::latency_samples() const {
     std::lock_guard<std::mutex> lock(latency_mutex_);
-    if (latencies_.empty()) return 0.0;
-    std::vector<uint64_t> copy = latencies_;
-    std::sort(copy.begin(), copy.end());
-    size_t idx = static_cast<size_t>(copy.size() * 0.95);
-    if (idx >= copy.size()) idx = copy.size() - 1;
-    return static_cast<double>(copy[idx]);
+    return latency_count_;
 }
 
-double Metrics::p99() const {
+LatencyPercentiles Metrics::percentiles() const {
     std::lock_guard<std::mutex> lock(latency_mutex_);
-    if (latencies_.empty()) return 0.0;
-    std::vector<uint64_t> copy = latencies_;
-    std::sort(copy.begin(), copy.end());
-    size_t idx = static_cast<size_t>(copy.size() * 0.99);
-    if (idx >= copy.size()) idx = copy.size() - 1;
-    return static_cast<double>(copy[idx]);
+    const uint64_t n = latency_buckets_.size();
+    if (n == 0) return {};
+    // Same ranks as indexing a sorted window: floor(n * q), clamped to the last sample
+    auto rank = [n](double q) { return std::min<uint64_t>(static_cast<uint64_t>(n * q), n - 1); };
+    const uint64_t ranks[3] = {rank(0.50), rank(0.95), rank(0.99)};
+    double values[3] = {};
+    uint64_t seen = 0;
+    size_t next = 0;
+    for (size_t b = 0; b < kLatencyBuckets && next < 3; ++b) {
+        seen += latency_histogram_[b];
+        while (next < 3 && ranks[next] < seen) values[next++] = latency_bucket_midpoint(b);
+    }
+    return {values[0], values[1], values[2]};
 }
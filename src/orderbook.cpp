@@ -2,6 +2,7 @@
 #include <iostream>
 #include <iomanip>
 #include <fstream> // for std::ofstream used in save_json
+#include <algorithm>
 
 OrderBook::OrderBook() {
     // Initialize free list - all nodes start as free
@@ -58,114 +59,100 @@ void OrderBook::remove_order_from_level(PriceLevel& level, OrderNode* node) {
     level.total_size -= node->size;
 }
 
-OrderBookChange OrderBook::apply_update(const DBNRecord& record) {
-    OrderBookChange change;
-    change.action = record.action;
+template <class Levels>
+void OrderBook::link_order(Levels& levels, OrderNode* node) {
+    insert_order_into_level(levels[node->price], node);
+}
 
-    switch (record.action) {
-        case 'A': {  // Add
-            auto node = allocate_node();
-            node->order_id = record.order_id;
-            node->price = record.price;
-            node->size = record.size;
-            node->side = record.side;
+template <class Levels>
+void OrderBook::unlink_order(Levels& levels, OrderNode* node) {
+    auto it = levels.find(node->price);
+    if (it == levels.end()) return;
+    remove_order_from_level(it->second, node);
+    if (it->second.head == nullptr) {
+        levels.erase(it);
+    }
+}
 
-            order_map_[record.order_id] = node;
+void OrderBook::add_order(std::uint64_t order_id, std::int64_t price, std::int32_t size, BookSide side) {
+    auto node = allocate_node();
+    node->order_id = order_id;
+    node->price = price;
+    node->size = size;
+    node->side = side;
 
-            if (record.side == 'B') {
-                insert_order_into_level(bids_[record.price], node);
-            } else {
-                insert_order_into_level(asks_[record.price], node);
-            }
-            break;
-        }
+    order_map_[order_id] = node;
+    on_side(side, [&](auto& levels) { link_order(levels, node); });
+}
 
-        case 'M': {  // Modify
-            auto it = order_map_.find(record.order_id);
-            if (it != order_map_.end()) {
-                OrderNode* node = it->second;
-                
-                // Remove from old price level
-                if (node->side == 'B') {
-                    auto& level = bids_[node->price];
-                    remove_order_from_level(level, node);
-                    if (level.total_size == 0) {
-                        bids_.erase(node->price);
-                    }
-                } else {
-                    auto& level = asks_[node->price];
-                    remove_order_from_level(level, node);
-                    if (level.total_size == 0) {
-                        asks_.erase(node->price);
-                    }
-                }
+bool OrderBook::modify_order(std::uint64_t order_id, std::int64_t price, std::int32_t size) {
+    auto it = order_map_.find(order_id);
+    if (it == order_map_.end()) return false;
+    OrderNode* node = it->second;
+    on_side(node->side, [&](auto& levels) {
+        // Remove from old price level, update, re-queue at the back of the new level
+        unlink_order(levels, node);
+        node->price = price;
+        node->size = size;
+        link_order(levels, node);
+    });
+    return true;
+}
 
-                // Update node
-                node->price = record.price;
-                node->size = record.size;
+bool OrderBook::cancel_order(std::uint64_t order_id) {
+    auto it = order_map_.find(order_id);
+    if (it == order_map_.end()) return false;
+    OrderNode* node = it->second;
+    on_side(node->side, [&](auto& levels) { unlink_order(levels, node); });
+    deallocate_node(node);
+    order_map_.erase(it);
+    return true;
+}
 
-                // Add to new price level
-                if (node->side == 'B') {
-                    insert_order_into_level(bids_[record.price], node);
-                } else {
-                    insert_order_into_level(asks_[record.price], node);
-                }
-            }
+OrderBookChange OrderBook::apply_update(const DBNRecord& record) {
+    switch (record.action) {
+        case 'A':  // Add
+            add_order(record.order_id, record.price, record.size, record.side == 'B' ? BookSide::Bid : BookSide::Ask);
             break;
-        }
-
-        case 'C': {  // Cancel
-            auto it = order_map_.find(record.order_id);
-            if (it != order_map_.end()) {
-                OrderNode* node = it->second;
-
-                if (node->side == 'B') {
-                    auto& level = bids_[node->price];
-                    remove_order_from_level(level, node);
-                    if (level.total_size == 0) {
-                        bids_.erase(node->price);
-                    }
-                } else {
-                    auto& level = asks_[node->price];
-                    remove_order_from_level(level, node);
-                    if (level.total_size == 0) {
-                        asks_.erase(node->price);
-                    }
-                }
-
-                deallocate_node(node);
-                order_map_.erase(record.order_id);
-            }
+        case 'M':  // Modify
+            if (!modify_order(record.order_id, record.price, record.size)) ++orphan_modifies_;
             break;
-        }
-
-        case 'F': {  // Fill
-            auto it = order_map_.find(record.order_id);
-            if (it != order_map_.end()) {
-                OrderNode* node = it->second;
+        case 'C':  // Cancel
+            if (!cancel_order(record.order_id)) ++orphan_cancels_;
+            break;
+        case 'F':  // Fill
+            if (!fill_order(record.order_id)) ++orphan_fills_;
+            break;
+        default:
+            ++unknown_actions_;
+            break;
+    }
 
-                if (node->side == 'B') {
-                    auto& level = bids_[node->price];
-                    remove_order_from_level(level, node);
-                    if (level.total_size == 0) {
-                        bids_.erase(node->price);
-                    }
-                } else {
-                    auto& level = asks_[node->price];
-                    remove_order_from_level(level, node);
-                    if (level.total_size == 0) {
-                        asks_.erase(node->price);
-                    }
-                }
+    OrderBookChange change = snapshot_top_of_book();
+    change.action = record.action;
+    return change;
+}
 
-                deallocate_node(node);
-                order_map_.erase(record.order_id);
+AuditReport OrderBook::audit() const {
+    AuditReport r;
+    auto walk = [&](const auto& levels) {
+        for (const auto& [price, level] : levels) {
+            ++r.levels_checked;
+            std::int64_t sum = 0;
+            std::uint32_t orders = 0;
+            for (const OrderNode* cur = level.head; cur; cur = cur->next) {
+                sum += cur->size;
+                ++orders;
+                if (cur->price != price) ++r.ladder_violations; // node filed under the wrong level
             }
-            break;
+            if (sum != level.total_size) ++r.level_total_mismatches;
+            if (level.total_size <= 0 || orders == 0) ++r.empty_levels;
         }
-    }
-
-    return snapshot_top_of_book();
+    };
+    walk(bids_);
+    walk(asks_);
+    if (!bids_.empty() && !asks_.empty() && bids_.begin()->first >= asks_.begin()->first) ++r.crossed_books;
+    return r;
 }
 
 std::pair<std::int64_t, std::int32_t> OrderBook::get_best_bid() const {
@@ -275,3 +262,39 @@ void OrderBook::save_json(const std::string& path, bool pretty) const {
     }
     ofs << to_json(pretty);
 }
+
+BookSnapshot OrderBook::snapshot(std::size_t levels) const {
+    auto copy_side = [levels](const auto& side, std::vector<LevelSnapshot>& out) {
+        out.reserve(levels == 0 ? side.size() : std::min(levels, side.size()));
+        for (const auto& [price, level] : side) {
+            if (levels != 0 && out.size() >= levels) break;
+            LevelSnapshot l;
+            l.price = price;
+            l.size = static_cast<std::uint32_t>(level.total_size);
+            for (OrderNode* cur = level.head; cur; cur = cur->next) ++l.count;
+            out.push_back(l);
+        }
+    };
+    PublisherSnapshot pub;
+    copy_side(bids_, pub.bids);
+    copy_side(asks_, pub.asks);
+    if (!pub.bids.empty()) pub.best_bid = pub.bids.front();
+    if (!pub.asks.empty()) pub.best_ask = pub.asks.front();
+
+    InstrumentSnapshot inst;
+    inst.agg_bid = pub.best_bid;
+    inst.agg_ask = pub.best_ask;
+    inst.publishers.push_back(std::move(pub));
+
+    BookSnapshot snap;
+    snap.instruments.push_back(std::move(inst));
+    return snap;
+}
+
+void OrderBook::save(const std::string& path, SnapshotFormat format) const {
+    if (format == SnapshotFormat::Json) {
+        save_json(path);
+        return;
+    }
+    save_snapshot(snapshot(), path, format);
+}
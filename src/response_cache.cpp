@@ -0,0 +1,114 @@
+#include "../include/response_cache.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+#ifdef HFT_HAS_ZLIB
+#include <zlib.h>
+#endif
+
+namespace {
+// Below this size gzip framing overhead outweighs the savings
+constexpr size_t kMinGzipBytes = 1024;
+
+// Versions restart at 1 with every process, so tags carry a per-process nonce: a validator
+// from an earlier run (possibly of another input) never matches a body of this one
+const std::string& process_nonce() {
+    static const std::string nonce = [] {
+        std::random_device rd;
+        const uint64_t t = static_cast<uint64_t>(std::chrono::system_clock::now().time_since_epoch().count());
+        std::ostringstream oss;
+        oss << std::hex << (t ^ (uint64_t{rd()} << 32) ^ rd());
+        return oss.str();
+    }();
+    return nonce;
+}
+}
+
+std::shared_ptr<const CachedResponse> ResponseCache::get(
+        uint64_t version, const std::function<std::shared_ptr<const std::string>()>& build) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (current_ && current_->version == version) return current_;
+    }
+    std::lock_guard<std::mutex> build_lock(build_mutex_);
+    {
+        // Another thread may have rebuilt while we waited
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (current_ && current_->version == version) return current_;
+    }
+    auto entry = std::make_shared<CachedResponse>();
+    entry->version = version;
+    std::ostringstream tag;
+    tag << '"' << etag_prefix_ << '-' << process_nonce() << '-' << std::hex << version;
+    entry->etag = tag.str() + '"';
+    entry->content_type = content_type_;
+    entry->body = build();
+    if (!entry->body) entry->body = std::make_shared<const std::string>();
+    if (entry->body->size() >= kMinGzipBytes) entry->gzip_body = gzip_compress(*entry->body);
+    if (entry->gzip_body) entry->gzip_etag = tag.str() + "-gz\"";
+    std::shared_ptr<const CachedResponse> frozen = std::move(entry);
+    std::lock_guard<std::mutex> lock(mutex_);
+    current_ = frozen;
+    return frozen;
+}
+
+bool ResponseCache::not_modified(const std::string& if_none_match, const CachedResponse& entry) {
+    if (if_none_match.empty()) return false;
+    if (if_none_match.find('*') != std::string::npos) return true;
+    // List of validators, possibly W/ prefixed; the closing quote keeps "x-1" from matching "x-1-gz"
+    if (if_none_match.find(entry.etag) != std::string::npos) return true;
+    return !entry.gzip_etag.empty() && if_none_match.find(entry.gzip_etag) != std::string::npos;
+}
+
+bool ResponseCache::accepts_gzip(const std::string& accept_encoding) {
+    // Comma-separated codings with optional ";q=" weights; q=0 means "not acceptable".
+    // An explicit gzip entry wins over "*".
+    double star_q = -1.0;
+    std::size_t pos = 0;
+    while (pos < accept_encoding.size()) {
+        std::size_t end = accept_encoding.find(',', pos);
+        if (end == std::string::npos) end = accept_encoding.size();
+        const std::string token = accept_encoding.substr(pos, end - pos);
+        pos = end + 1;
+        const std::size_t semi = token.find(';');
+        std::string name = token.substr(0, semi);
+        name.erase(0, name.find_first_not_of(" \t"));
+        name.erase(name.find_last_not_of(" \t") + 1);
+        std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+        double q = 1.0;
+        if (semi != std::string::npos) {
+            const std::size_t qpos = token.find_first_not_of(" \t", semi + 1);
+            if (qpos != std::string::npos && (token[qpos] == 'q' || token[qpos] == 'Q') && qpos + 1 < token.size() && token[qpos + 1] == '=') {
+                q = std::strtod(token.c_str() + qpos + 2, nullptr);
+            }
+        }
+        if (name == "gzip") return q > 0.0;
+        if (name == "*") star_q = q;
+    }
+    return star_q > 0.0;
+}
+
+std::shared_ptr<const std::string> gzip_compress(const std::string& data) {
+#ifdef HFT_HAS_ZLIB
+    z_stream zs{};
+    // windowBits 15 + 16 selects the gzip wrapper
+    if (deflateInit2(&zs, Z_BEST_SPEED, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) return nullptr;
+    std::string out;
+    out.resize(deflateBound(&zs, static_cast<uLong>(data.size())) + 32);
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    zs.avail_in = static_cast<uInt>(data.size());
+    zs.next_out = reinterpret_cast<Bytef*>(&out[0]);
+    zs.avail_out = static_cast<uInt>(out.size());
+    int rc = deflate(&zs, Z_FINISH);
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+    if (rc != Z_STREAM_END) return nullptr;
+    return std::make_shared<const std::string>(std::move(out));
+#else
+    (void)data;
+    return nullptr;
+#endif
+}
@@ -0,0 +1,105 @@
+#include "../include/sampler.h"
+#include "../include/byte_writer.h"
+#include <algorithm>
+#include <stdexcept>
+
+BookSampler::BookSampler(const SamplerConfig& config) : config_(config) {
+    out_.open(config_.path, std::ios::binary | std::ios::trunc);
+    if (!out_.is_open()) {
+        throw std::runtime_error("Failed to open sample output: " + config_.path);
+    }
+    if (config_.depth == 0) config_.depth = 1;
+    buffer_.reserve(config_.buffer_bytes + 16 + 32 * config_.depth);
+    if (config_.format == SampleFormat::Binary) {
+        buffer_.append("HFTL2S01", 8);
+        le::put_u16(buffer_, static_cast<std::uint16_t>(config_.depth));
+        le::put_u16(buffer_, 0);
+        le::put_u32(buffer_, static_cast<std::uint32_t>(16 + 32 * config_.depth));
+        le::put_u64(buffer_, config_.interval_ns);
+        le::put_u64(buffer_, config_.every_events);
+    } else {
+        buffer_ += "ts_recv,instrument_id,publisher_id";
+        for (std::size_t i = 0; i < config_.depth; ++i) {
+            std::string n = (i < 10 ? "0" : "") + std::to_string(i);
+            buffer_ += ",bid_px_" + n + ",ask_px_" + n + ",bid_sz_" + n + ",ask_sz_" + n + ",bid_ct_" + n + ",ask_ct_" + n;
+        }
+        buffer_ += "\n";
+    }
+}
+
+BookSampler::~BookSampler() {
+    flush();
+}
+
+bool BookSampler::due_before(std::uint64_t ts_recv) {
+    if (config_.interval_ns == 0) return false;
+    if (next_boundary_ == 0) {
+        // First event anchors the grid; nothing to sample yet
+        next_boundary_ = (ts_recv / config_.interval_ns + 1) * config_.interval_ns;
+        return false;
+    }
+    if (ts_recv < next_boundary_) return false;
+    // One row per crossing, stamped at the latest boundary not after this event (gaps are not back-filled)
+    sample_ts_ = ts_recv / config_.interval_ns * config_.interval_ns;
+    next_boundary_ = sample_ts_ + config_.interval_ns;
+    return true;
+}
+
+bool BookSampler::due_after() {
+    if (config_.every_events == 0) return false;
+    return ++events_ % config_.every_events == 0;
+}
+
+void BookSampler::write_row(std::uint64_t ts, std::uint32_t instrument_id, std::uint16_t publisher_id,
+                            const LevelSnapshot* bids, std::size_t n_bids,
+                            const LevelSnapshot* asks, std::size_t n_asks) {
+    const std::size_t depth = config_.depth;
+    n_bids = std::min(n_bids, depth);
+    n_asks = std::min(n_asks, depth);
+    static const LevelSnapshot empty{};
+    if (config_.format == SampleFormat::Binary) {
+        le::put_u64(buffer_, ts);
+        le::put_u32(buffer_, instrument_id);
+        le::put_u16(buffer_, publisher_id);
+        le::put_u16(buffer_, static_cast<std::uint16_t>(std::max(n_bids, n_asks)));
+        for (std::size_t i = 0; i < depth; ++i) {
+            const LevelSnapshot& b = i < n_bids ? bids[i] : empty;
+            const LevelSnapshot& a = i < n_asks ? asks[i] : empty;
+            le::put_i64(buffer_, b.price);
+            le::put_i64(buffer_, a.price);
+            le::put_u32(buffer_, b.size);
+            le::put_u32(buffer_, a.size);
+            le::put_u32(buffer_, b.count);
+            le::put_u32(buffer_, a.count);
+        }
+    } else {
+        auto px = [](std::int64_t p) { return p == kSnapshotUndefPrice ? std::string() : std::to_string(p); };
+        buffer_ += std::to_string(ts);
+        buffer_ += ',';
+        buffer_ += std::to_string(instrument_id);
+        buffer_ += ',';
+        buffer_ += std::to_string(publisher_id);
+        for (std::size_t i = 0; i < depth; ++i) {
+            const LevelSnapshot& b = i < n_bids ? bids[i] : empty;
+            const LevelSnapshot& a = i < n_asks ? asks[i] : empty;
+            buffer_ += ',' + px(b.price) + ',' + px(a.price) + ',' + std::to_string(b.size) + ',' + std::to_string(a.size) +
+                       ',' + std::to_string(b.count) + ',' + std::to_string(a.count);
+        }
+        buffer_ += '\n';
+    }
+    ++rows_;
+    if (buffer_.size() >= config_.buffer_bytes) flush();
+}
+
+void BookSampler::flush() {
+    if (buffer_.empty() || !out_.is_open()) return;
+    out_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+    out_.flush();
+    buffer_.clear(); // keeps capacity: steady state does not reallocate
+}
+
+SampleFormat sample_format_from_path(const std::string& path) {
+    const std::string ext = ".csv";
+    if (path.size() >= ext.size() && path.compare(path.size() - ext.size(), ext.size(), ext) == 0) return SampleFormat::Csv;
+    return SampleFormat::Binary;
+}
@@ -0,0 +1,227 @@
+#include "../include/snapshot.h"
+#include "../include/byte_writer.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+using le::put_u8;
+using le::put_u16;
+using le::put_u32;
+using le::put_u64;
+
+namespace {
+
+std::size_t capped(std::size_t n, std::size_t max_levels) {
+    return max_levels == 0 ? n : std::min(n, max_levels);
+}
+
+// Prices formatted as decimal with 2 places (raw / 1e9)
+std::string fmt_price(std::int64_t px) {
+    if (px == kSnapshotUndefPrice) return "null";
+    std::ostringstream os;
+    os.setf(std::ios::fixed);
+    os << std::setprecision(2) << static_cast<double>(px) / 1e9;
+    return os.str();
+}
+
+void json_level(std::ostringstream& oss, const LevelSnapshot& l) {
+    oss << "{\"price\": " << fmt_price(l.price) << ", \"size\": " << l.size << ", \"count\": " << l.count << "}";
+}
+
+void json_levels(std::ostringstream& oss, const std::vector<LevelSnapshot>& levels, std::size_t max_levels) {
+    std::size_t n = capped(levels.size(), max_levels);
+    for (std::size_t i = 0; i < n; ++i) {
+        if (i > 0) oss << ",";
+        oss << "              ";
+        json_level(oss, levels[i]);
+        oss << "\n";
+    }
+}
+
+void put_level(std::string& out, const LevelSnapshot& l) {
+    le::put_i64(out, l.price);
+    put_u32(out, l.size);
+    put_u32(out, l.count);
+}
+
+constexpr std::size_t kColumnAlign = 64;
+constexpr std::size_t kColumnDirEntryBytes = 40;
+constexpr std::size_t kColumnHeaderBytes = 40;
+
+} // namespace
+
+std::string snapshot_to_json(const BookSnapshot& snap, std::size_t max_levels) {
+    if (!snap.error.empty()) return snap.error;
+    std::ostringstream oss;
+    oss << "{\n  \"instruments\": [\n";
+    bool first_inst = true;
+    for (const auto& inst : snap.instruments) {
+        if (!first_inst) oss << ",\n";
+        first_inst = false;
+        oss << "    {\n      \"instrument_id\": " << inst.instrument_id << ",\n      \"publishers\": [\n";
+        bool first_pub = true;
+        for (const auto& pb : inst.publishers) {
+            if (!first_pub) oss << ",\n";
+            first_pub = false;
+            oss << "        {\n          \"publisher_id\": " << pb.publisher_id << ",\n          \"bbo\": {\n            \"bid\": ";
+            json_level(oss, pb.best_bid);
+            oss << ",\n            \"ask\": ";
+            json_level(oss, pb.best_ask);
+            oss << "\n          },\n          \"levels\": {\n            \"bids\": [\n";
+            json_levels(oss, pb.bids, max_levels);
+            oss << "            ],\n            \"asks\": [\n";
+            json_levels(oss, pb.asks, max_levels);
+            oss << "            ]\n          }\n        }"; // end publisher
+        }
+        oss << "\n      ],\n      \"aggregated_bbo\": {\n        \"bid\": ";
+        json_level(oss, inst.agg_bid);
+        oss << ",\n        \"ask\": ";
+        json_level(oss, inst.agg_ask);
+        oss << "\n      }\n    }";
+    }
+    oss << "\n  ],\n  \"last_ts_recv_iso\": \"" << snap.last_ts_recv_iso << "\",\n  \"mbo_count\": " << snap.mbo_count << "\n}\n";
+    return oss.str();
+}
+
+std::string snapshot_to_binary(const BookSnapshot& snap, std::size_t max_levels) {
+    std::size_t total = 32;
+    for (const auto& inst : snap.instruments) {
+        total += 40;
+        for (const auto& pb : inst.publishers) {
+            total += 12 + 32 + 16 * (capped(pb.bids.size(), max_levels) + capped(pb.asks.size(), max_levels));
+        }
+    }
+    std::string out;
+    out.reserve(total);
+    out.append("HFTBOOK1", 8);
+    put_u16(out, 1);
+    put_u16(out, 0);
+    put_u32(out, static_cast<std::uint32_t>(snap.instruments.size()));
+    put_u64(out, snap.mbo_count);
+    put_u64(out, snap.last_ts_recv);
+    for (const auto& inst : snap.instruments) {
+        put_u32(out, inst.instrument_id);
+        put_u16(out, static_cast<std::uint16_t>(inst.publishers.size()));
+        put_u16(out, 0);
+        put_level(out, inst.agg_bid);
+        put_level(out, inst.agg_ask);
+        for (const auto& pb : inst.publishers) {
+            std::size_t nb = capped(pb.bids.size(), max_levels);
+            std::size_t na = capped(pb.asks.size(), max_levels);
+            put_u16(out, pb.publisher_id);
+            put_u16(out, 0);
+            put_u32(out, static_cast<std::uint32_t>(nb));
+            put_u32(out, static_cast<std::uint32_t>(na));
+            put_level(out, pb.best_bid);
+            put_level(out, pb.best_ask);
+            for (std::size_t i = 0; i < nb; ++i) put_level(out, pb.bids[i]);
+            for (std::size_t i = 0; i < na; ++i) put_level(out, pb.asks[i]);
+        }
+    }
+    return out;
+}
+
+std::string snapshot_to_columnar(const BookSnapshot& snap, std::size_t max_levels) {
+    struct Column {
+        const char* name;
+        char type;
+        std::uint8_t width;
+        std::string data;
+    };
+    Column cols[] = {
+        {"instrument_id", 'u', 4, {}}, {"publisher_id", 'u', 2, {}}, {"side", 'u', 1, {}}, {"depth", 'u', 4, {}},
+        {"price", 'i', 8, {}},         {"size", 'u', 4, {}},         {"count", 'u', 4, {}},
+    };
+    constexpr std::size_t kColumns = sizeof(cols) / sizeof(cols[0]);
+
+    std::uint64_t rows = 0;
+    for (const auto& inst : snap.instruments) {
+        for (const auto& pb : inst.publishers) rows += capped(pb.bids.size(), max_levels) + capped(pb.asks.size(), max_levels);
+    }
+    for (auto& c : cols) c.data.reserve(rows * c.width);
+
+    auto emit = [&](std::uint32_t inst, std::uint16_t pub, char side, const std::vector<LevelSnapshot>& levels) {
+        std::size_t n = capped(levels.size(), max_levels);
+        for (std::size_t i = 0; i < n; ++i) {
+            put_u32(cols[0].data, inst);
+            put_u16(cols[1].data, pub);
+            put_u8(cols[2].data, static_cast<std::uint8_t>(side));
+            put_u32(cols[3].data, static_cast<std::uint32_t>(i)); // u16 would wrap past 65535 levels
+            put_u64(cols[4].data, static_cast<std::uint64_t>(levels[i].price));
+            put_u32(cols[5].data, levels[i].size);
+            put_u32(cols[6].data, levels[i].count);
+        }
+    };
+    for (const auto& inst : snap.instruments) {
+        for (const auto& pb : inst.publishers) {
+            emit(inst.instrument_id, pb.publisher_id, 'B', pb.bids);
+            emit(inst.instrument_id, pb.publisher_id, 'A', pb.asks);
+        }
+    }
+
+    auto align = [](std::size_t n) { return (n + kColumnAlign - 1) / kColumnAlign * kColumnAlign; };
+    std::size_t offset = align(kColumnHeaderBytes + kColumns * kColumnDirEntryBytes);
+    std::string out;
+    out.append("HFTCOL01", 8);
+    put_u32(out, static_cast<std::uint32_t>(kColumns));
+    put_u32(out, 0);
+    put_u64(out, rows);
+    put_u64(out, snap.mbo_count);
+    put_u64(out, snap.last_ts_recv);
+    for (const auto& c : cols) {
+        char name[16] = {};
+        std::strncpy(name, c.name, sizeof(name) - 1);
+        out.append(name, sizeof(name));
+        put_u8(out, static_cast<std::uint8_t>(c.type));
+        put_u8(out, c.width);
+        put_u16(out, 0);
+        put_u32(out, 0);
+        put_u64(out, offset);
+        put_u64(out, c.data.size());
+        offset = align(offset + c.data.size());
+    }
+    out.reserve(offset);
+    for (const auto& c : cols) {
+        out.resize(align(out.size()), '\0');
+        out += c.data;
+    }
+    return out;
+}
+
+std::string serialize_snapshot(const BookSnapshot& snap, SnapshotFormat format, std::size_t max_levels) {
+    switch (format) {
+        case SnapshotFormat::Binary: return snapshot_to_binary(snap, max_levels);
+        case SnapshotFormat::Columnar: return snapshot_to_columnar(snap, max_levels);
+        case SnapshotFormat::Json: default: return snapshot_to_json(snap, max_levels);
+    }
+}
+
+const char* snapshot_content_type(SnapshotFormat format) {
+    switch (format) {
+        case SnapshotFormat::Binary: return kBinaryContentType;
+        case SnapshotFormat::Columnar: return kColumnarContentType;
+        case SnapshotFormat::Json: default: return kJsonContentType;
+    }
+}
+
+SnapshotFormat snapshot_format_from_path(const std::string& path) {
+    auto ends_with = [&](const char* ext) {
+        std::size_t n = std::strlen(ext);
+        return path.size() >= n && path.compare(path.size() - n, n, ext) == 0;
+    };
+    if (ends_with(".bin")) return SnapshotFormat::Binary;
+    if (ends_with(".col") || ends_with(".arrow")) return SnapshotFormat::Columnar;
+    return SnapshotFormat::Json;
+}
+
+void save_snapshot(const BookSnapshot& snap, const std::string& path, SnapshotFormat format, std::size_t max_levels) {
+    std::ofstream ofs(path, std::ios::binary);
+    if (!ofs.is_open()) {
+        throw std::runtime_error("Failed to open file for snapshot output: " + path);
+    }
+    std::string data = serialize_snapshot(snap, format, max_levels);
+    ofs.write(data.data(), static_cast<std::streamsize>(data.size()));
+}
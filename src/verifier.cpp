@@ -0,0 +1,128 @@
+#include "../include/verifier.h"
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+// `better(a, b)` is true when a is strictly better than b (bids: higher, asks: lower)
+template <class Better>
+void audit_ladder(const std::vector<LevelSnapshot>& levels, const LevelSnapshot& best, Better better, AuditReport& r) {
+    r.levels_checked += levels.size();
+    for (std::size_t i = 0; i < levels.size(); ++i) {
+        const LevelSnapshot& l = levels[i];
+        if (l.price == kSnapshotUndefPrice || (i > 0 && !better(levels[i - 1].price, l.price))) ++r.ladder_violations;
+        if (l.size == 0 || l.count > l.size) ++r.empty_levels;
+    }
+    const LevelSnapshot expect = levels.empty() ? LevelSnapshot{} : levels.front();
+    if (best.price != expect.price || best.size != expect.size || best.count != expect.count) ++r.bbo_mismatches;
+}
+
+bool same_level(const LevelSnapshot& a, const LevelSnapshot& b) {
+    return a.price == b.price && a.size == b.size && a.count == b.count;
+}
+
+// Reference (scalar) reduction of publisher tops, independent of the SIMD kernels
+template <class Better>
+LevelSnapshot best_of(const std::vector<PublisherSnapshot>& pubs, LevelSnapshot PublisherSnapshot::*top, Better better) {
+    LevelSnapshot out;
+    for (const auto& pb : pubs) {
+        const LevelSnapshot& l = pb.*top;
+        if (l.price == kSnapshotUndefPrice) continue;
+        if (out.price == kSnapshotUndefPrice || better(l.price, out.price)) {
+            out = l;
+        } else if (l.price == out.price) {
+            out.size += l.size;
+            out.count += l.count;
+        }
+    }
+    return out;
+}
+
+} // namespace
+
+AuditReport audit_snapshot(const BookSnapshot& snap) {
+    AuditReport r;
+    auto higher = [](std::int64_t a, std::int64_t b) { return a > b; };
+    auto lower = [](std::int64_t a, std::int64_t b) { return a < b; };
+    for (const auto& inst : snap.instruments) {
+        for (const auto& pb : inst.publishers) {
+            audit_ladder(pb.bids, pb.best_bid, higher, r);
+            audit_ladder(pb.asks, pb.best_ask, lower, r);
+            if (pb.best_bid.price != kSnapshotUndefPrice && pb.best_ask.price != kSnapshotUndefPrice &&
+                pb.best_bid.price >= pb.best_ask.price) {
+                ++r.crossed_books;
+            }
+        }
+        if (!same_level(inst.agg_bid, best_of(inst.publishers, &PublisherSnapshot::best_bid, higher))) ++r.bbo_mismatches;
+        if (!same_level(inst.agg_ask, best_of(inst.publishers, &PublisherSnapshot::best_ask, lower))) ++r.bbo_mismatches;
+        if (inst.agg_bid.price != kSnapshotUndefPrice && inst.agg_ask.price != kSnapshotUndefPrice &&
+            inst.agg_bid.price >= inst.agg_ask.price) {
+            ++r.crossed_aggregated;
+        }
+    }
+    r.level_total_mismatches = snap.level_total_mismatches;
+    return r;
+}
+
+BookVerifier::BookVerifier(SnapshotSource source, const UpdateNotifier& updates, Metrics& metrics,
+                           std::function<void()> request_recount, VerifierOptions options)
+    : source_(std::move(source)), updates_(updates), metrics_(metrics), request_recount_(std::move(request_recount)),
+      options_(options) {}
+
+BookVerifier::~BookVerifier() {
+    stop();
+}
+
+void BookVerifier::start() {
+    if (running_.exchange(true)) return;
+    if (request_recount_) request_recount_(); // the first publish is recounted
+    thread_ = std::thread([this] { run(); });
+}
+
+void BookVerifier::stop() {
+    running_.store(false);
+    updates_.wake();
+    { std::lock_guard<std::mutex> lock(window_mutex_); }
+    window_cv_.notify_all();
+    if (thread_.joinable()) thread_.join();
+}
+
+void BookVerifier::run() {
+    using clock = std::chrono::steady_clock;
+    std::uint64_t audited = 0;
+    clock::time_point next_audit{};
+    auto stopping = [this] { return !running_.load(std::memory_order_relaxed); };
+    while (!stopping() && !updates_.is_shutdown()) {
+        // One wait for a version newer than the last audited one; stop() wakes it through the notifier
+        const auto wait = std::max<clock::duration>(next_audit - clock::now(), options_.interval);
+        std::uint64_t version = updates_.wait_for_change(audited, wait, stopping);
+        if (version == audited) continue;
+        // Sampling window: a version published inside it is audited (as the newest) when it closes
+        {
+            std::unique_lock<std::mutex> lock(window_mutex_);
+            window_cv_.wait_until(lock, next_audit, stopping);
+        }
+        if (stopping()) break;
+        std::uint64_t snap_version = 0;
+        auto snap = source_(&snap_version);
+        if (!snap || !snap->error.empty()) {
+            audited = snap_version;
+            continue;
+        }
+        const AuditReport r = audit_snapshot(*snap);
+        audited = snap_version;
+        next_audit = clock::now() + options_.interval;
+
+        metrics_.audits_run.fetch_add(1, std::memory_order_relaxed);
+        if (!r.clean()) metrics_.audits_failed.fetch_add(1, std::memory_order_relaxed);
+        metrics_.crossed_books.store(r.crossed_books, std::memory_order_relaxed);
+        metrics_.crossed_aggregated.store(r.crossed_aggregated, std::memory_order_relaxed);
+        metrics_.ladder_violations.store(r.ladder_violations, std::memory_order_relaxed);
+        metrics_.empty_levels.store(r.empty_levels, std::memory_order_relaxed);
+        metrics_.bbo_mismatches.store(r.bbo_mismatches, std::memory_order_relaxed);
+        if (snap->level_totals_audited) {
+            metrics_.level_total_mismatches.store(r.level_total_mismatches, std::memory_order_relaxed);
+        }
+        if (request_recount_) request_recount_();
+    }
+}